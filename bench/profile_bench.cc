@@ -0,0 +1,233 @@
+// Profile采样热路径微基准：
+// 1. 对比std::map实现与FlatMap+符号驻留实现的单条采样耗时
+// 2. 分片并行聚合在1/2/4/8个线程下的批次吞吐
+// 构建运行：cmake --build <build_dir> --target profile_bench && <build_dir>/profile_bench [samples]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "profile.h"
+#include "aggregator.h"
+
+#define BENCH_ADDRS 4000
+#define BENCH_FUNCS 800
+#define BENCH_DEFAULT_SAMPLES 20000000
+// 并行聚合：单批次采样数（对应整机4000Hz采样时的一次回调），进程数及其中两个目标应用各自的进程数
+#define BENCH_BATCH_SAMPLES 524288
+#define BENCH_PROCS 64
+#define BENCH_APP_PROCS 16
+
+typedef struct {
+    unsigned long addr;
+    unsigned long offset;
+    const char *name;
+} BenchSymbol;
+
+// 原std::map实现的profile结构及采样更新逻辑
+typedef struct {
+    std::string name;
+    unsigned long offset;
+    int count;
+} MapAddrInfo;
+
+typedef struct {
+    std::map<unsigned long, MapAddrInfo> addrs;
+    std::map<std::string, std::map<unsigned long, int>> funcs;
+} MapProfile;
+
+static void map_update(MapProfile &profile, const BenchSymbol &symbol)
+{
+    auto &addrs = profile.addrs;
+    auto &funcs = profile.funcs;
+    if (addrs.find(symbol.addr) != addrs.end()) {
+        addrs[symbol.addr].count++;
+        funcs[addrs[symbol.addr].name][symbol.offset]++;
+    } else {
+        addrs[symbol.addr] = MapAddrInfo();
+        addrs[symbol.addr].name = symbol.name;
+        addrs[symbol.addr].offset = symbol.offset;
+        addrs[symbol.addr].count = 1;
+        funcs[addrs[symbol.addr].name][symbol.offset] = 1;
+    }
+}
+
+// 与update_app_profile_data中原始二进制采样的处理一致
+static void flat_update(Profile &profile, const BenchSymbol &symbol, int weight = 1)
+{
+    AddrInfo *info = profile.addrs.find(symbol.addr);
+    if (info != nullptr) {
+        info->count += weight;
+        profile.funcs[info->sym][symbol.offset] += weight;
+        return;
+    }
+    uint32_t id = profile_intern_func(profile, symbol.name);
+    profile.addrs[symbol.addr] = AddrInfo{id, symbol.offset, weight, 0};
+    profile.funcs[id][symbol.offset] = weight;
+}
+
+template <typename F>
+static double run_ns_per_sample(const std::vector<uint32_t> &stream, F update)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t index : stream) {
+        update(index);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / stream.size();
+}
+
+static uint64_t next_random(uint64_t &seed)
+{
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return seed >> 33;
+}
+
+// 构造与入队后结构一致的批次：进程0~15属于应用0，16~31属于应用1，其余为非目标进程；
+// 目标进程约1/5的采样落在libc中，聚合时需被过滤
+static void build_bench_batch(const std::vector<BenchSymbol> &symbols, SampleBatch &batch,
+    SampleOwners &owners, std::vector<uint32_t> &symbol_refs)
+{
+    const uint32_t libc = 2;
+    batch.modules = {0, 0, 0};
+    owners.target_apps = {0, 1};
+    owners.module_apps = {0, 1, AGGREGATION_NO_OWNER};
+    for (uint32_t i = 0; i < BENCH_PROCS; ++i) {
+        SampleProc proc{(pid_t)(1000 + i), 0, {0}};
+        batch.procs.push_back(proc);
+        owners.proc_targets.push_back(i < 2 * BENCH_APP_PROCS ? i / BENCH_APP_PROCS : AGGREGATION_NO_OWNER);
+    }
+
+    // libkperf按(pid, 地址)给出symbol，入队时按symbol去重
+    FlatMap<uint32_t> index;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (uint32_t i = 0; i < BENCH_BATCH_SAMPLES; ++i) {
+        uint32_t proc = (uint32_t)(next_random(seed) % BENCH_PROCS);
+        uint32_t r = (uint32_t)next_random(seed);
+        uint32_t addr = (r & 3) != 0 ? r % (BENCH_ADDRS / 20) : r % BENCH_ADDRS;
+        bool inserted = false;
+        uint32_t &symbol = index.get_or_insert(((uint64_t)proc << 32) | addr, &inserted);
+        if (inserted) {
+            symbol = (uint32_t)batch.symbols.size();
+            uint32_t app = owners.proc_targets[proc];
+            uint32_t module = (app == AGGREGATION_NO_OWNER || addr % 5 == 0) ? libc : app;
+            batch.symbols.push_back(SampleSymbol{symbols[addr].addr, symbols[addr].offset, module, SAMPLE_NO_STRING});
+            symbol_refs.push_back(addr);
+        }
+        batch.samples.push_back(SampleRecord{(int64_t)i, proc, symbol});
+    }
+}
+
+// 按给定线程数聚合批次并将结果合入各应用profile，返回每秒处理的采样数
+static double run_parallel(int threads, size_t rounds, const std::vector<BenchSymbol> &symbols,
+    const SampleBatch &batch, const SampleOwners &owners, const std::vector<uint32_t> &symbol_refs,
+    std::vector<Profile> &profiles)
+{
+    ShardedAggregator aggregator;
+    aggregator.start(threads);
+    profiles.assign(owners.target_apps.size(), Profile());
+    for (Profile &profile : profiles) {
+        profile_clear(profile);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        size_t shards = aggregator.aggregate(batch, owners);
+        for (size_t target = 0; target < profiles.size(); ++target) {
+            for (size_t shard = 0; shard < shards; ++shard) {
+                for (const AddrEntry &entry : aggregator.partial(shard).targets[target].entries) {
+                    flat_update(profiles[target], symbols[symbol_refs[entry.symbol]], entry.count);
+                }
+            }
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    aggregator.stop();
+    double seconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1e9;
+    return (double)(rounds * batch.samples.size()) / seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t samples = argc > 1 ? strtoull(argv[1], nullptr, 10) : BENCH_DEFAULT_SAMPLES;
+    if (samples == 0) {
+        fprintf(stderr, "usage: %s [samples]\n", argv[0]);
+        return 1;
+    }
+
+    // 模拟C++应用的长修饰名，每个函数包含若干采样地址
+    std::vector<std::string> names;
+    for (int i = 0; i < BENCH_FUNCS; ++i) {
+        names.push_back("_ZN7service6module14RequestHandler" + std::to_string(i) + "EPNS_7ContextERKSs");
+    }
+    std::vector<BenchSymbol> symbols;
+    for (int i = 0; i < BENCH_ADDRS; ++i) {
+        int func = i % BENCH_FUNCS;
+        unsigned long offset = (unsigned long)(i / BENCH_FUNCS) * 4;
+        symbols.push_back(BenchSymbol{0x400000UL + (unsigned long)func * 0x1000 + offset, offset, names[func].c_str()});
+    }
+
+    // 固定种子的偏斜分布，少量热点地址占大部分采样
+    std::vector<uint32_t> stream(samples);
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    for (size_t i = 0; i < samples; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        uint32_t r = (uint32_t)(seed >> 33);
+        stream[i] = (r & 3) != 0 ? r % (BENCH_ADDRS / 20) : r % BENCH_ADDRS;
+    }
+
+    MapProfile map_profile;
+    double map_ns = run_ns_per_sample(stream, [&](uint32_t index) { map_update(map_profile, symbols[index]); });
+    Profile flat_profile;
+    profile_clear(flat_profile);
+    double flat_ns = run_ns_per_sample(stream, [&](uint32_t index) { flat_update(flat_profile, symbols[index]); });
+
+    // 校验两种实现的结果一致
+    for (const auto &item : map_profile.addrs) {
+        const AddrInfo *info = flat_profile.addrs.find(item.first);
+        if (info == nullptr || info->count != item.second.count ||
+            flat_profile.symbols.name(info->sym) != item.second.name) {
+            fprintf(stderr, "mismatch at addr 0x%lx\n", item.first);
+            return 1;
+        }
+    }
+
+    printf("samples: %zu, addrs: %d, funcs: %d\n", samples, BENCH_ADDRS, BENCH_FUNCS);
+    printf("std::map : %.1f ns/sample\n", map_ns);
+    printf("FlatMap  : %.1f ns/sample\n", flat_ns);
+    printf("speedup  : %.1fx\n", map_ns / flat_ns);
+
+    // 并行聚合：各线程数下的结果需与单线程一致
+    SampleBatch batch;
+    SampleOwners owners;
+    std::vector<uint32_t> symbol_refs;
+    build_bench_batch(symbols, batch, owners, symbol_refs);
+    size_t rounds = (samples + BENCH_BATCH_SAMPLES - 1) / BENCH_BATCH_SAMPLES;
+    printf("\nparallel aggregation: %zu batches x %d samples, %zu symbols\n",
+        rounds, BENCH_BATCH_SAMPLES, batch.symbols.size());
+    std::vector<Profile> expected;
+    double base = 0;
+    for (int threads : {1, 2, 4, 8}) {
+        std::vector<Profile> profiles;
+        double rate = run_parallel(threads, rounds, symbols, batch, owners, symbol_refs, profiles);
+        if (threads == 1) {
+            base = rate;
+            expected = std::move(profiles);
+        } else {
+            for (size_t target = 0; target < expected.size(); ++target) {
+                bool same = expected[target].addrs.size() == profiles[target].addrs.size();
+                expected[target].addrs.for_each([&](uint64_t addr, const AddrInfo &info) {
+                    const AddrInfo *other = profiles[target].addrs.find(addr);
+                    same = same && other != nullptr && other->count == info.count;
+                });
+                if (!same) {
+                    fprintf(stderr, "mismatch of app %zu with %d threads\n", target, threads);
+                    return 1;
+                }
+            }
+        }
+        printf("threads %d: %.1f M samples/s, speedup %.2fx\n", threads, rate / 1e6, rate / base);
+    }
+    return 0;
+}
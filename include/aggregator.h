@@ -0,0 +1,86 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __AGGREGATOR_H__
+#define __AGGREGATOR_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "flat_map.h"
+#include "sample_batch.h"
+
+// 批次采样数少于该值时串行处理，避免线程同步开销
+#define PARALLEL_AGGREGATION_MIN_SAMPLES 16384
+// 不属于任何目标实例的进程或不属于任何目标应用的模块
+#define AGGREGATION_NO_OWNER UINT32_MAX
+
+// 聚合前由调用线程按批次内的进程和模块解析出的归属，数量与采样数无关
+typedef struct {
+    std::vector<uint32_t> proc_targets;  // 进程下标 -> 目标实例下标
+    std::vector<uint32_t> target_apps;   // 目标实例下标 -> 所属应用编号
+    std::vector<uint32_t> module_apps;   // 模块下标 -> 所属应用编号
+} SampleOwners;
+
+// 目标实例内同一地址的采样合并后的结果
+typedef struct {
+    uint32_t symbol; // 该地址第一条采样的符号下标
+    int64_t ts;      // 该地址第一条采样的时间戳
+    int count;
+} AddrEntry;
+
+// 单个目标实例的局部地址直方图
+typedef struct {
+    FlatMap<uint32_t> index;        // 地址 -> entries下标
+    std::vector<AddrEntry> entries; // 按首次出现顺序排列，保证合并结果确定
+} AddrHistogram;
+
+// 单个分片的局部直方图，按目标实例分开
+typedef struct {
+    std::vector<AddrHistogram> targets;
+} PartialHistogram;
+
+// 分片并行聚合：每个线程对批次的一个连续分片过滤非目标模块的采样，并按目标实例构建局部地址直方图，
+// 调用线程只需按分片顺序将直方图合入各应用的profile
+class ShardedAggregator {
+public:
+    void start(int threads);
+    void stop();
+    // 构建各分片的局部直方图，返回使用的分片数，结果在下一次调用前有效
+    size_t aggregate(const SampleBatch &batch, const SampleOwners &owners);
+    const PartialHistogram &partial(size_t index) const
+    {
+        return partials[index];
+    }
+
+private:
+    void worker_loop(size_t index);
+    void build_partial(size_t index);
+
+    std::vector<std::thread> workers;
+    std::vector<PartialHistogram> partials;
+    std::mutex mtx;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    uint64_t generation = 0;
+    size_t pending = 0;
+    bool stopping = false;
+    const SampleBatch *batch = nullptr;
+    const SampleOwners *owners = nullptr;
+    size_t shards = 1;
+};
+
+extern ShardedAggregator sharded_aggregator;
+
+#endif
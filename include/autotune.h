@@ -0,0 +1,49 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __AUTOTUNE_H__
+#define __AUTOTUNE_H__
+
+#include <string>
+#include <vector>
+
+// 调优历史记录文件：<TUNER_PROFILE_DIR>/<app_name>.autotune
+#define AUTOTUNE_FILE_SUFFIX ".autotune"
+// 每个候选选项至少验证的轮数，全部候选达到后固定使用得分最好且未超过回退阈值的选项
+#define AUTOTUNE_TRIALS 2
+
+// 一组候选BOLT选项及其验证得分
+typedef struct {
+    std::string options;
+    std::vector<double> scores; // 每轮验证的CPI变化百分比，越小越好
+} AutotuneCandidate;
+
+// 应用的BOLT选项自动调优状态，在持有app的profile锁时访问
+typedef struct {
+    bool enabled;
+    std::string path;                          // 调优历史记录文件
+    std::vector<AutotuneCandidate> candidates;
+    int active;                                // 最近一次优化成功使用的候选，-1表示无
+    int pinned;                                // 收敛后固定使用的候选，-1表示尚未收敛
+    double threshold;                          // 可固定的最大平均得分，与验证回退阈值一致
+    bool exhausted;                            // 全部候选的平均得分均超过阈值，不再优化该应用
+} AutotuneState;
+
+// 以base_options为首个候选构建搜索空间，并从path恢复调优历史
+extern void autotune_init(AutotuneState &state, const std::string &base_options, const std::string &path,
+    double threshold);
+// 选择本轮优化使用的候选：已收敛时返回固定候选，已放弃时返回-1，否则轮转到验证次数最少的候选
+extern int autotune_select(const AutotuneState &state);
+// 记录active候选的一轮验证得分并追加到历史记录，返回是否新收敛
+extern bool autotune_record(AutotuneState &state, double score);
+extern double autotune_mean_score(const AutotuneCandidate &candidate);
+
+#endif
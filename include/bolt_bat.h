@@ -0,0 +1,67 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __BOLT_BAT_H__
+#define __BOLT_BAT_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define BAT_SECTION_NAME ".note.bolt_bat"
+#define BAT_NOTE_NAME "BOLT"
+// 输入偏移最高位标记该位置为分支入口
+#define BAT_BRANCH_ENTRY 0x80000000U
+
+typedef struct {
+    uint32_t output_offset;  // 优化后函数内偏移
+    uint32_t input_offset;   // 原始函数内偏移
+} BatEntry;
+
+typedef struct {
+    uint64_t addr;   // 优化后函数（或函数片段）起始地址
+    uint32_t begin;  // 在entries中的起始下标
+    uint32_t count;
+} BatFunction;
+
+typedef struct {
+    uint64_t cold_addr;  // 冷片段起始地址
+    uint64_t hot_addr;   // 所属主函数起始地址
+} BatColdPart;
+
+// BOLT地址转换表（BAT），记录优化后二进制中地址与原始函数偏移的对应关系，
+// 由llvm-bolt --enable-bat写入.note.bolt_bat段
+class BoltAddressTranslation {
+public:
+    // 解析binary的BAT段，当前支持LLVM 17及以前的定长格式
+    int load(const std::string &binary);
+    void unload();
+    bool loaded() const
+    {
+        return !bin_identity.empty();
+    }
+    const std::string &identity() const
+    {
+        return bin_identity;
+    }
+    // 将func_addr函数内的offset转换为原始函数内偏移，func_addr不在BAT中时说明函数未被改写，偏移不变
+    uint64_t translate(uint64_t func_addr, uint64_t offset) const;
+    // 冷片段返回所属主函数的起始地址，否则返回func_addr本身
+    uint64_t parent(uint64_t func_addr) const;
+
+private:
+    std::string bin_identity;
+    std::vector<BatFunction> functions;  // 按addr排序
+    std::vector<BatEntry> entries;       // 每个函数内按output_offset排序
+    std::vector<BatColdPart> cold_parts; // 按cold_addr排序
+};
+
+#endif
@@ -0,0 +1,48 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <cstdint>
+#include <string>
+
+#include "configs.h"
+
+#define CHECKPOINT_MAGIC "DFOTCKP1"
+#define CHECKPOINT_SEGMENT_MAGIC 0x504b4344U
+#define CHECKPOINT_SUFFIX ".ckpt"
+
+// 检查点文件格式：CheckpointHeader + 若干增量段，每段为CheckpointSegment + CheckpointEntry[count]，
+// 只追加写入，末尾不完整或校验失败的段在恢复时丢弃
+typedef struct {
+    char magic[8];
+    char identity[16];  // 原始二进制标识，恢复时校验
+    int64_t ts;         // profile起始时间
+} CheckpointHeader;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t count;
+    uint64_t checksum;  // 对entries的FNV-1a校验
+} CheckpointSegment;
+
+typedef struct {
+    uint64_t addr;
+    int64_t delta;      // 相对上一次检查点的计数变化
+} CheckpointEntry;
+
+// 将app未导出的原始二进制采样增量追加到检查点，调用方持有profile_mtx
+extern int checkpoint_app_profile(AppConfig *app);
+// 二进制标识未变化时从检查点恢复采样数据，在采集开始前调用
+extern int restore_app_profile(AppConfig *app);
+
+#endif
@@ -15,22 +15,30 @@
 #include <string>
 #include <map>
 #include <mutex>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
 
 #include "logs.h"
+#include "profile.h"
+#include "elf_symbols.h"
+#include "bolt_bat.h"
+#include "load_monitor.h"
+#include "validation.h"
+#include "autotune.h"
 
 #define DEFAULT_DFOT_CONFIG_PATH "/etc/dfot/dfot.ini"
-
-typedef struct {
-    std::string name;
-    unsigned long offset;
-    int count;
-} AddrInfo;
-
-typedef struct {
-    int64_t ts;
-    std::map<unsigned long, AddrInfo> addrs;
-    std::map<std::string, std::map<unsigned long, int>> funcs;
-} Profile;
+#define DEFAULT_COLLECTOR_QUEUE_SIZE 16
+#define DEFAULT_COLLECTOR_MAX_PIDS 65536
+#define DEFAULT_TUNER_PROFILE_HISTORY 4
+#define DEFAULT_COLLECTOR_CHECKPOINT_PERIOD 60000
+// 未配置BOLT_OPTIONS时使用的BOLT优化选项
+#define DEFAULT_BOLT_OPTIONS \
+    "-reorder-blocks=ext-tsp -reorder-functions=hfsort+ " \
+    "-split-functions -split-all-cold -icf=1 " \
+    "-use-gnu-stack --inline-all"
+// 内核进程名长度上限（含结尾'\0'），采样中的comm会被截断到该长度
+#define TASK_COMM_LEN 16
 
 enum APP_STATUS {
     UNOPTIMIZED,    // 未优化状态
@@ -44,19 +52,32 @@ typedef struct AppConfig {
     std::string app_name;
     std::string full_path;
     int         current_pid;        // app当前运行进程的pid
-    char        build_id[20];       // app二进制对应的buildid，用于校验采样对象和优化对象是否一致
+    std::string build_id;           // app二进制对应的buildid（十六进制），用于校验采样对象、profile和优化对象是否一致
 
     Profile      profile;           // app对应profile数据
-    std::string  collected_profile; // app对应profile文件路径
+    std::string  collected_profile; // app的perf2bolt转换中间文件路径前缀
     std::mutex   profile_mtx;       // collector和tuner操作profile的互斥锁
 
     std::string  default_profile;   // 开箱profile
     unsigned int collector_dump_data_threshold;
-    APP_STATUS   status;
+    std::atomic<APP_STATUS> status; // tuner线程每个周期无锁预检查，聚合线程在持锁时修改
     std::string  bolt_dir;
     std::string  bolt_options;
     bool         update_debug_info;
+    double       hot_coverage;      // 热点函数模式下热点函数覆盖的采样比例，单位%，0表示处理全部函数
+    ProfileWindow window;           // profile数据老化方式
+    ProfileConvergence convergence; // profile收敛检测，收敛后触发导出
+    double       cumulative_weight; // 累积模式下历史profile的权重，0表示每轮只使用本轮数据
+    int64_t      last_checkpoint;   // 上一次写检查点的时间
+    std::unordered_map<pid_t, uint64_t> cpu_times; // 采样策略1：上一次统计时各进程累计的CPU时间，单位clock tick
+    int64_t      cpu_ts;            // 采样策略1：上一次统计的时间
+    double       cpu_usage;         // 采样策略1：应用所有进程的CPU使用率之和，单位%，多核累加
     std::vector<BinaryInstance *> instances;
+    SymbolIndex  symbol_index;      // 原始二进制的符号索引，导出profile时批量解析未解析地址
+    SymbolIndex  bolted_index;      // 最新优化版本二进制的符号索引
+    BoltAddressTranslation bat;     // 最新优化版本二进制的地址转换表，用于将采样地址还原为原始函数偏移
+    AppValidation validation;       // 优化版本的性能验证状态
+    AutotuneState autotune;         // BOLT选项自动调优状态
 } AppConfig;
 
 struct BinaryInstance {
@@ -64,6 +85,7 @@ struct BinaryInstance {
     unsigned int version;       // 优化版本标记，0表示未优化的原始版本，1表示第一次优化版本，以此类推
     std::string full_path; // 优化实例的二进制路径
     int64_t id;            // 优化实例的区分标记，当前暂时使用create_time
+    std::string build_id;  // 实例二进制的buildid，BOLT优化会保留原始二进制的buildid
 };
 
 enum TUNER_OPTIMIZING_STRATEGY {
@@ -77,16 +99,37 @@ typedef struct {
     log4cplus::LogLevel log_level;
     int sampling_strategy;
     int high_load_threshold;
+    int high_load_hysteresis;
+    int high_load_check_period;
     int collector_sampling_period;
     int collector_sampling_freq;
     int collector_data_aging_time;
+    int collector_queue_size;
+    int collector_queue_block_time;
+    int collector_aggregation_threads;
+    int collector_max_pids;
+    bool collector_match_exe_path;
+    int collector_checkpoint_period;
     std::string tuner_tool; 
     int tuner_check_period;
     std::string tuner_profile_dir;
+    int tuner_profile_history;
     TUNER_OPTIMIZING_STRATEGY tuner_optimizing_strategy;
     int tuner_optimizing_condition;
+    int tuner_optimizing_jobs;
+    int tuner_optimizing_timeout;
+    int tuner_optimizing_nice;
+    std::string tuner_optimizing_cpus;
+    std::string tuner_optimizing_cgroup;
+    int tuner_optimizing_memory_limit;
+    LoadPolicy tuner_low_load;
+    double tuner_validation_threshold;
+    int tuner_validation_window;
 
     std::vector<AppConfig *> apps;
+    // 配置加载时构建的应用索引，应用匹配耗时与应用数量无关
+    std::unordered_map<std::string, std::vector<AppConfig *>> comm_index; // 截断后的进程名 -> 应用
+    std::unordered_map<std::string, AppConfig *> path_index;              // 二进制路径（含.rto） -> 应用
 } GlobalConfig;
 
 extern GlobalConfig *configs;
@@ -94,6 +137,7 @@ extern void cleanup_configs();
 extern void debug_print_configs();
 
 extern int parse_dfot_ini(std::string ini_path);
+extern AppConfig *match_app(const char *comm, pid_t pid);
 extern bool check_configs_valid();
 
 #endif
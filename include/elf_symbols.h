@@ -0,0 +1,90 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __ELF_SYMBOLS_H__
+#define __ELF_SYMBOLS_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define SYMBOL_INDEX_MAGIC "DFOTSYM1"
+
+// 只读映射的文件
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+} MappedFile;
+
+// 符号索引文件格式：SymbolIndexHeader + SymbolEntry[count] + 字符串表
+typedef struct {
+    char magic[8];
+    uint64_t count;
+    uint64_t strtab_size;
+} SymbolIndexHeader;
+
+typedef struct {
+    uint64_t addr;  // 函数起始虚拟地址
+    uint64_t size;  // 函数大小，0表示未知
+    uint32_t name;  // 函数名在字符串表中的偏移
+    uint32_t reserved;
+} SymbolEntry;
+
+// 按地址排序的函数符号索引，由二进制的.symtab/.dynsym生成，mmap方式加载
+class SymbolIndex {
+public:
+    SymbolIndex() = default;
+    SymbolIndex(const SymbolIndex &) = delete;
+    SymbolIndex &operator=(const SymbolIndex &) = delete;
+    ~SymbolIndex();
+
+    // 加载binary的符号索引，cache_dir下有对应二进制标识的缓存时直接映射，否则解析ELF并写入缓存
+    int load(const std::string &binary, const std::string &cache_dir);
+    void unload();
+    bool loaded() const
+    {
+        return entries != nullptr;
+    }
+    const std::string &identity() const
+    {
+        return bin_identity;
+    }
+    // 查找包含addr的函数，返回函数名并通过offset返回函数内偏移，未找到返回nullptr
+    const char *lookup(uint64_t addr, uint64_t *offset) const;
+    size_t size() const
+    {
+        return count;
+    }
+
+private:
+    int map_index(const std::string &path);
+
+    std::string bin_identity;
+    void *map = nullptr;
+    size_t map_size = 0;
+    const SymbolEntry *entries = nullptr;
+    size_t count = 0;
+    const char *strtab = nullptr;
+    size_t strtab_size = 0;
+};
+
+extern int map_file(const std::string &path, MappedFile *file);
+extern void unmap_file(MappedFile *file);
+// 文件标识（16位十六进制），由路径、inode、大小和修改时间生成，用于与文件本身绑定的缓存
+extern std::string get_file_identity(const std::string &path);
+// 读取ELF的NT_GNU_BUILD_ID，返回十六进制字符串，没有build-id时返回空串
+extern std::string read_elf_build_id(const std::string &path);
+// 二进制标识（16位十六进制），优先由build-id生成，用于判断profile等数据是否对应当前二进制
+extern std::string get_bin_identity(const std::string &path);
+// 解析ELF的.symtab/.dynsym，生成按地址排序的函数符号索引文件
+extern int build_symbol_index(const std::string &binary, const std::string &index_path);
+
+#endif
@@ -0,0 +1,91 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __EXECUTOR_H__
+#define __EXECUTOR_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "configs.h"
+
+// 保留最近结束的任务记录数，用于调试打印，执行器停止时清空
+#define OPTIMIZE_JOB_HISTORY 32
+
+enum JOB_STATE {
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_DONE,
+    JOB_FAILED,
+    JOB_CANCELLED
+};
+
+enum JOB_TYPE {
+    JOB_OPTIMIZE, // 生成并使能优化版本
+    JOB_ROLLBACK  // 回退性能下降的优化版本
+};
+
+typedef struct {
+    uint64_t id;
+    AppConfig *app;
+    JOB_TYPE type;
+    std::string profile;   // 提交时的profile快照，优化期间重新导出的profile不影响本次任务，回退任务为空
+    bool stored;           // 快照为二进制格式保存的profile，执行时转换为BOLT profile
+    JOB_STATE state;
+    int64_t submit_ts;
+    int64_t start_ts;
+    int64_t end_ts;
+} OptimizeJob;
+
+// 优化任务执行器：Run()只负责提交任务，优化和回退命令在独立的工作线程中执行，
+// 同一应用同时最多一个未结束的任务
+class OptimizeExecutor {
+public:
+    void start(int concurrency);
+    // 取消排队中的任务，终止运行中任务的外部命令并等待任务结束
+    void stop();
+    bool submit(AppConfig *app, const std::string &profile);
+    // 提交回退任务，应用已有未结束的任务时不提交，返回false
+    bool submit_rollback(AppConfig *app);
+    // 应用是否有排队中或运行中的任务
+    bool busy(AppConfig *app);
+    void debug_print();
+    // 执行器停止时置位，运行中的外部命令据此终止
+    const std::atomic<bool> *cancel_flag() const
+    {
+        return &cancelling;
+    }
+
+private:
+    void worker_loop();
+    bool busy_locked(AppConfig *app);
+    void finish(const std::shared_ptr<OptimizeJob> &job, JOB_STATE state);
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::atomic<bool> cancelling{false};
+    uint64_t next_id = 1;
+    std::deque<std::shared_ptr<OptimizeJob>> queue;
+    std::vector<std::shared_ptr<OptimizeJob>> running;
+    std::deque<std::shared_ptr<OptimizeJob>> history;
+    std::vector<std::thread> workers;
+};
+
+extern OptimizeExecutor optimize_executor;
+
+#endif
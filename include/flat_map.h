@@ -0,0 +1,205 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __FLAT_MAP_H__
+#define __FLAT_MAP_H__
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+// 空槽位标记，该键值不能作为有效key使用
+#define FLAT_MAP_EMPTY_KEY (~0ULL)
+
+// 以64位整数为key的开放寻址哈希表（线性探测），数据连续存放，
+// 用于采样热路径上替代std::map，减少指针跳转和内存分配
+template <typename V>
+class FlatMap {
+public:
+    explicit FlatMap(size_t capacity = 16)
+    {
+        reset(capacity);
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    V *find(uint64_t key)
+    {
+        for (size_t i = slot_of(key); ; i = (i + 1) & mask) {
+            if (slots[i].key == key) {
+                return &slots[i].value;
+            }
+            if (slots[i].key == FLAT_MAP_EMPTY_KEY) {
+                return nullptr;
+            }
+        }
+    }
+
+    const V *find(uint64_t key) const
+    {
+        return const_cast<FlatMap *>(this)->find(key);
+    }
+
+    // 查找key，不存在时插入默认值，inserted用于返回是否为新插入
+    V &get_or_insert(uint64_t key, bool *inserted = nullptr)
+    {
+        if ((count + 1) * 4 > slots.size() * 3) {
+            rehash(slots.size() * 2);
+        }
+        size_t i = slot_of(key);
+        for (; slots[i].key != FLAT_MAP_EMPTY_KEY; i = (i + 1) & mask) {
+            if (slots[i].key == key) {
+                if (inserted != nullptr) {
+                    *inserted = false;
+                }
+                return slots[i].value;
+            }
+        }
+        slots[i].key = key;
+        slots[i].value = V();
+        count++;
+        if (inserted != nullptr) {
+            *inserted = true;
+        }
+        return slots[i].value;
+    }
+
+    V &operator[](uint64_t key)
+    {
+        return get_or_insert(key);
+    }
+
+    // 删除key，采用后移删除，不留墓碑
+    bool erase(uint64_t key)
+    {
+        size_t i = slot_of(key);
+        for (; slots[i].key != key; i = (i + 1) & mask) {
+            if (slots[i].key == FLAT_MAP_EMPTY_KEY) {
+                return false;
+            }
+        }
+        for (size_t j = (i + 1) & mask; slots[j].key != FLAT_MAP_EMPTY_KEY; j = (j + 1) & mask) {
+            size_t home = slot_of(slots[j].key);
+            // home不在(i, j]区间内时，j位置的元素可以前移到i
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i].key = FLAT_MAP_EMPTY_KEY;
+        slots[i].value = V();
+        count--;
+        return true;
+    }
+
+    // 清空数据并释放多余内存
+    void clear()
+    {
+        reset(16);
+    }
+
+    // 清空数据但保留容量，用于每批次重复使用的临时表
+    void clear_keep_capacity()
+    {
+        std::fill(slots.begin(), slots.end(), Slot{FLAT_MAP_EMPTY_KEY, V()});
+        count = 0;
+    }
+
+    template <typename F>
+    void for_each(F func) const
+    {
+        for (const Slot &slot : slots) {
+            if (slot.key != FLAT_MAP_EMPTY_KEY) {
+                func(slot.key, slot.value);
+            }
+        }
+    }
+
+    template <typename F>
+    void for_each(F func)
+    {
+        for (Slot &slot : slots) {
+            if (slot.key != FLAT_MAP_EMPTY_KEY) {
+                func(slot.key, slot.value);
+            }
+        }
+    }
+
+    // 按key升序返回，用于需要稳定输出顺序的场景（如导出profile）
+    std::vector<uint64_t> sorted_keys() const
+    {
+        std::vector<uint64_t> keys;
+        keys.reserve(count);
+        for_each([&keys](uint64_t key, const V &) { keys.push_back(key); });
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    }
+
+private:
+    struct Slot {
+        uint64_t key;
+        V value;
+    };
+
+    std::vector<Slot> slots;
+    size_t mask;
+    size_t count;
+    unsigned int shift;
+
+    size_t slot_of(uint64_t key) const
+    {
+        // fibonacci hash，取高位作为槽位下标
+        return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> shift);
+    }
+
+    void reset(size_t capacity)
+    {
+        size_t size = 16;
+        unsigned int bits = 4;
+        while (size < capacity) {
+            size <<= 1;
+            bits++;
+        }
+        slots.assign(size, Slot{FLAT_MAP_EMPTY_KEY, V()});
+        slots.shrink_to_fit();
+        mask = size - 1;
+        shift = 64 - bits;
+        count = 0;
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Slot> old;
+        old.swap(slots);
+        reset(capacity);
+        for (Slot &slot : old) {
+            if (slot.key == FLAT_MAP_EMPTY_KEY) {
+                continue;
+            }
+            size_t i = slot_of(slot.key);
+            while (slots[i].key != FLAT_MAP_EMPTY_KEY) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = slot;
+            count++;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,64 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __LOAD_MONITOR_H__
+#define __LOAD_MONITOR_H__
+
+#include <cstdint>
+
+#define PROC_STAT_PATH "/proc/stat"
+#define PROC_LOADAVG_PATH "/proc/loadavg"
+#define PSI_CPU_PATH "/proc/pressure/cpu"
+#define PSI_MEMORY_PATH "/proc/pressure/memory"
+
+typedef struct {
+    double cpu_usage;    // 两次采样间的整机CPU使用率，单位%
+    double load;         // 1分钟平均负载 / CPU数，单位%
+    double psi_cpu;      // CPU压力some avg10，单位%，内核不支持PSI时为0
+    double psi_memory;   // 内存压力some avg10，单位%
+} LoadMetrics;
+
+typedef struct {
+    double threshold;      // CPU使用率和平均负载低于该值视为空闲，单位%
+    double psi_threshold;  // PSI低于该值视为空闲，单位%
+    double hysteresis;     // 进入空闲后，指标超过阈值+该值才退出空闲，避免在阈值附近反复切换
+    int64_t quiet_time;    // 持续空闲达到该时长才判定为低负载，单位ms
+} LoadPolicy;
+
+// 整机负载监控，由tuner线程周期性调用sample更新
+class LoadMonitor {
+public:
+    void init(const LoadPolicy &load_policy);
+    void sample(int64_t now);
+    bool low_load(int64_t now) const
+    {
+        return idle && now - idle_since >= policy.quiet_time;
+    }
+    const LoadMetrics &current() const
+    {
+        return metrics;
+    }
+    void debug_print(int64_t now) const;
+
+private:
+    bool read_cpu_usage();
+
+    LoadPolicy policy{};
+    LoadMetrics metrics{};
+    uint64_t last_busy = 0;
+    uint64_t last_total = 0;
+    bool idle = false;
+    int64_t idle_since = 0;
+};
+
+extern LoadMonitor load_monitor;
+
+#endif
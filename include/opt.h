@@ -16,11 +16,17 @@
 
 #include <libkperf/pmu.h>
 #include "configs.h"
+#include "pipeline.h"
 
 extern bool check_dependence_ready();
 extern bool is_app_eligible_for_optimization(AppConfig *app);
 extern std::string get_app_profile(AppConfig *app);
-extern void process_pmudata(struct PmuData *data, int len);
-extern void do_optimize(AppConfig *app, std::string profile);
+extern void process_pmudata(const SampleBatch &batch);
+extern bool do_optimize(AppConfig *app, const std::string &profile);
+extern bool update_app_cpu_usage(bool sampling);
+extern int get_target_pid(AppConfig *app);
+extern void validate_app_performance(AppConfig *app, int64_t now);
+extern bool rollback_app_optimization(AppConfig *app);
+extern void debug_print_validation(const AppConfig *app);
 
 #endif
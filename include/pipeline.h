@@ -0,0 +1,67 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <oeaware/data_list.h>
+
+#include "sample_batch.h"
+
+// 单生产者单消费者有界无锁环形队列
+// 生产者为oeAware回调线程（UpdateData），消费者为聚合线程
+class SampleRing {
+public:
+    void init(size_t capacity);
+    // 获取可写槽位，队列满时返回nullptr
+    SampleBatch *acquire_write();
+    void commit_write();
+    // 获取可读槽位，队列空时返回nullptr
+    SampleBatch *acquire_read();
+    void commit_read();
+    size_t depth() const;
+    size_t capacity() const
+    {
+        return slots.size() - 1;
+    }
+
+private:
+    std::vector<SampleBatch> slots;
+    alignas(64) std::atomic<size_t> head{0}; // 下一个可读位置，仅消费者修改
+    alignas(64) std::atomic<size_t> tail{0}; // 下一个可写位置，仅生产者修改
+};
+
+// 采样数据异步聚合流水线：UpdateData只负责入队，由独立线程执行process_pmudata
+class AggregationPipeline {
+public:
+    bool start(size_t queue_size, int block_time);
+    void stop();
+    // 将一批采样数据入队，队列满且等待超时后丢弃并计数
+    bool submit(const DataList &dataList);
+
+private:
+    void worker_loop();
+
+    SampleRing ring;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::mutex wait_mtx;
+    std::condition_variable wait_cv;
+    int block_time = 0; // 队列满时生产者最长等待时间，单位ms
+};
+
+#endif
@@ -0,0 +1,53 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __PROCESS_RUNNER_H__
+#define __PROCESS_RUNNER_H__
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+
+// 外部命令默认超时时间，单位ms
+#define DEFAULT_EXEC_TIMEOUT 60000
+// 超时或取消时先发送SIGTERM，等待该时长后仍未退出则发送SIGKILL，单位ms
+#define EXEC_KILL_GRACE 10000
+// 保留的命令输出上限，超出部分丢弃，单位字节
+#define EXEC_OUTPUT_LIMIT (1 << 20)
+// 输出管道容量，单位字节
+#define EXEC_PIPE_SIZE (1 << 20)
+
+typedef struct {
+    int timeout = DEFAULT_EXEC_TIMEOUT;  // 超时时间，单位ms，0表示不限制
+    int nice = 0;                        // 子进程nice值，0表示不调整
+    std::string cpus;                    // 子进程可使用的CPU列表（如"0-3,8"），空表示不限制
+    std::vector<std::pair<int, rlim_t>> rlimits; // 子进程资源限制：资源类型 -> 软硬限制
+    std::string cgroup;                  // 子进程加入的cgroup目录，空表示不加入
+    const std::atomic<bool> *cancel = nullptr;   // 置位后终止子进程
+} ExecOptions;
+
+typedef struct {
+    std::string cmd_log;  // 标准输出和标准错误
+    int ret;              // 退出码，被信号终止时为128+信号值，启动失败或无法回收时为-1
+    bool timed_out;       // 是否因超时被终止
+    bool cancelled;       // 是否因取消被终止
+    int64_t elapsed;      // 执行耗时，单位ms
+    long max_rss;         // 子进程及其已回收后代的峰值RSS，单位KB
+} exec_result;
+
+// 不经过shell直接执行argv[0]（按PATH查找），子进程位于独立进程组，超时或取消时终止整个进程组
+extern exec_result exec_cmd(const std::vector<std::string> &argv, const ExecOptions &options = ExecOptions());
+extern std::string format_cmd(const std::vector<std::string> &argv);
+
+#endif
@@ -0,0 +1,73 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __PROCESS_TRACKER_H__
+#define __PROCESS_TRACKER_H__
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "configs.h"
+
+// 无法订阅进程事件时，查询触发/proc全量扫描的最小间隔，单位ms
+#define PROCESS_SCAN_PERIOD 1000
+// 事件线程检查退出标记的间隔，单位ms
+#define PROCESS_EVENT_POLL_INTERVAL 200
+
+typedef struct {
+    AppConfig *app;
+    bool optimized; // 进程运行的是否为.rto优化版本
+} TrackedProcess;
+
+// 目标应用进程跟踪：优先通过netlink proc connector订阅exec/fork/exit事件，
+// 没有CAP_NET_ADMIN等无法订阅的场景下退化为按需扫描/proc，查询均不创建子进程
+class ProcessTracker {
+public:
+    void start();
+    void stop();
+    // 返回应用的任一存活进程，optimized返回该进程是否运行优化版本，应用未运行时返回-1
+    pid_t find(AppConfig *app, bool *optimized = nullptr);
+    // 返回应用的全部存活进程
+    std::vector<pid_t> pids(AppConfig *app);
+    // 查询pid是否为已跟踪的目标应用进程
+    bool lookup(pid_t pid, TrackedProcess *process);
+    void debug_print();
+
+private:
+    bool subscribe();
+    void event_loop();
+    void handle_events(const char *buffer, ssize_t len);
+    void scan();
+    void refresh();
+    // 以下函数调用方持有mtx
+    void track(pid_t pid, const TrackedProcess &process);
+    void untrack(pid_t pid);
+    bool track_exe(pid_t pid);
+
+    std::mutex mtx;
+    std::unordered_map<pid_t, TrackedProcess> procs;
+    std::unordered_map<AppConfig *, std::set<pid_t>> live;
+    std::atomic<int> sock{-1}; // 启停时由使能线程修改，查询线程和事件线程读取
+    std::atomic<bool> running{false};
+    std::thread worker;
+    int64_t last_scan = 0;
+    uint64_t events = 0;
+    uint64_t scans = 0;
+};
+
+extern ProcessTracker process_tracker;
+
+#endif
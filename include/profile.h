@@ -0,0 +1,118 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+
+#include "flat_map.h"
+
+// 无函数名信息的地址（如BOLT优化后二进制的采样地址）
+#define INVALID_SYMBOL_ID UINT32_MAX
+// 采样时未解析符号的地址，导出时批量解析
+#define UNRESOLVED_SYMBOL_ID (UINT32_MAX - 1)
+// 热点函数列表文件后缀，与profile文件同名，每行一个函数名
+#define HOT_FUNCS_SUFFIX ".funcs"
+
+typedef struct {
+    uint32_t sym;          // 函数名在符号表中的ID
+    unsigned long offset;  // 函数内偏移
+    int count;
+    int saved;             // 已写入检查点的计数，占用结构体对齐空洞，不增加内存
+} AddrInfo;
+
+// 函数名驻留表，同名字符串只保存一份，通过32位ID引用
+class SymbolTable {
+public:
+    uint32_t intern(const char *name);
+    const std::string &name(uint32_t id) const
+    {
+        return names[id];
+    }
+    size_t size() const
+    {
+        return names.size();
+    }
+    void clear();
+
+private:
+    std::deque<std::string> names;  // deque扩容不移动已有元素，index中的string_view保持有效
+    std::unordered_map<std::string_view, uint32_t> index;
+};
+
+// profile时间窗口模式
+enum PROFILE_WINDOW_MODE {
+    WINDOW_RESET = 0,   // 超过老化时间后丢弃全部数据
+    WINDOW_BUCKETS = 1, // 按时间桶滚动，最老的桶逐个老化
+    WINDOW_DECAY = 2    // 每个时间桶周期对历史计数按系数衰减
+};
+
+typedef struct {
+    PROFILE_WINDOW_MODE mode;
+    int buckets;         // 老化时间内的时间桶数量
+    double decay_factor; // 衰减模式下每个周期的保留系数，(0, 1)
+    int64_t epoch_len;   // 单个时间桶时长，单位ms
+} ProfileWindow;
+
+// profile收敛检测配置：定期比较热点函数分布，连续多次稳定后触发导出
+typedef struct {
+    bool enabled;
+    int top_n;              // 参与比较的热点函数数量
+    double similarity;      // 相邻两次快照的加权相似度阈值，(0, 1]
+    int stable_rounds;      // 连续达到相似度阈值的次数
+    int64_t interval;       // 检测间隔，单位ms
+    int64_t min_samples;    // 采样数低于该值时不判断收敛
+    int64_t max_samples;    // 采样数达到该值时无论是否收敛都导出，0表示不限制
+} ProfileConvergence;
+
+// 热点分布快照：{函数或地址key: 采样占比}，按key排序
+typedef std::vector<std::pair<uint64_t, double>> HotShares;
+
+typedef struct {
+    int64_t last_check;
+    int stable;
+    HotShares shares;
+} ConvergenceState;
+
+typedef struct {
+    int64_t ts;
+    // 收敛检测的上一次快照
+    ConvergenceState convergence;
+    // 检查点增量：profile被清空后需要重写检查点；已写入检查点后被老化删除的地址及其检查点计数
+    bool ckpt_reset;
+    std::vector<std::pair<uint64_t, int>> ckpt_erased;
+    // 当前时间桶的起始时间
+    int64_t epoch_ts;
+    // 时间桶环，每个桶记录该时间段内各地址的采样数，仅WINDOW_BUCKETS模式使用
+    std::deque<FlatMap<int>> buckets;
+    // {内存地址addr: {函数ID sym, 偏移offset, 计数count}, ...}
+    FlatMap<AddrInfo> addrs;
+    // 函数名驻留表
+    SymbolTable symbols;
+    // 以函数ID为下标: {偏移offset: 计数count, ...}
+    std::vector<FlatMap<int>> funcs;
+} Profile;
+
+extern void profile_clear(Profile &profile);
+extern uint32_t profile_intern_func(Profile &profile, const char *name);
+extern std::vector<uint32_t> profile_sorted_funcs(const Profile &profile);
+extern void profile_advance_window(Profile &profile, const ProfileWindow &window, int64_t ts);
+extern void profile_window_add(Profile &profile, const ProfileWindow &window, uint64_t addr, int weight);
+extern HotShares profile_hot_shares(const Profile &profile, int top_n, int64_t *total);
+extern double hot_shares_similarity(const HotShares &a, const HotShares &b);
+
+#endif
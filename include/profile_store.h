@@ -0,0 +1,91 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __PROFILE_STORE_H__
+#define __PROFILE_STORE_H__
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "profile.h"
+
+#define PROFILE_STORE_MAGIC "DFOTPRF1"
+#define PROFILE_STORE_SUFFIX ".dprof"
+// 由保存的profile转换得到的BOLT profile（fdata）文件后缀
+#define PROFILE_FDATA_SUFFIX ".fdata"
+
+// 二进制profile文件格式：ProfileStoreHeader + ProfileStoreFunc[func_count] + 字符串表 + 数据区
+// 函数表按函数名排序，数据区中每个函数的偏移按升序差分后与计数交替以LEB128变长编码
+typedef struct {
+    char magic[8];
+    int64_t ts;           // 导出时间
+    uint32_t func_count;
+    uint32_t reserved;
+    uint64_t strtab_size;
+    uint64_t data_size;
+} ProfileStoreHeader;
+
+typedef struct {
+    uint32_t name;    // 函数名在字符串表中的偏移
+    uint32_t count;   // 偏移数量
+    uint64_t data;    // 在数据区中的起始位置
+} ProfileStoreFunc;
+
+// mmap方式加载的历史profile，只读
+class StoredProfile {
+public:
+    StoredProfile() = default;
+    StoredProfile(const StoredProfile &) = delete;
+    StoredProfile &operator=(const StoredProfile &) = delete;
+    ~StoredProfile();
+
+    int load(const std::string &path);
+    void unload();
+    int64_t ts() const
+    {
+        return header == nullptr ? 0 : header->ts;
+    }
+    uint32_t size() const
+    {
+        return header == nullptr ? 0 : header->func_count;
+    }
+    std::string_view name(uint32_t index) const;
+    // 遍历函数的{偏移: 计数}，数据损坏时返回DFOT_ERROR
+    int for_each(uint32_t index, const std::function<void(uint64_t, uint64_t)> &f) const;
+
+private:
+    void *map = nullptr;
+    size_t map_size = 0;
+    const ProfileStoreHeader *header = nullptr;
+    const ProfileStoreFunc *funcs = nullptr;
+    const char *strtab = nullptr;
+    const uint8_t *data = nullptr;
+};
+
+// 按binary标识保存profile的历史版本，文件名为<app_name>_<identity>.<generation>.dprof
+extern std::string profile_store_path(const std::string &dir, const std::string &app_name,
+    const std::string &identity, uint64_t generation);
+// 返回已保存的历史版本号，升序
+extern std::vector<uint64_t> profile_store_generations(const std::string &dir, const std::string &app_name,
+    const std::string &identity);
+// 将内存中的profile保存为新版本，只保留最近history个版本（至少保留最新版本作为优化输入），
+// 同时删除该应用其他二进制标识（二进制已升级）的版本
+extern int profile_store_save(const Profile &profile, const std::string &dir, const std::string &app_name,
+    const std::string &identity, int history, int64_t ts);
+// 将历史profile按权重累加到内存profile的函数直方图中，计数向下取整
+extern void profile_merge_stored(Profile &profile, const StoredProfile &stored, double weight);
+// 将保存的profile转换为BOLT profile文件fdata，hot_coverage（取值(0, 1]）大于0时同时生成热点函数列表
+extern int profile_store_export(const std::string &path, const std::string &fdata, double hot_coverage);
+
+#endif
@@ -0,0 +1,56 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __PROFILE_WRITER_H__
+#define __PROFILE_WRITER_H__
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define PROFILE_WRITER_BUFFER_SIZE (1 << 20)
+
+// profile文件写入器：内存缓冲格式化，写入同目录临时文件，commit时fsync后rename原子替换目标文件，
+// 读取方只会看到旧文件或完整的新文件
+class ProfileWriter {
+public:
+    ProfileWriter() = default;
+    ProfileWriter(const ProfileWriter &) = delete;
+    ProfileWriter &operator=(const ProfileWriter &) = delete;
+    ~ProfileWriter();
+
+    int open(const std::string &path);
+    ProfileWriter &append(std::string_view str);
+    ProfileWriter &append(char c);
+    ProfileWriter &append_dec(int64_t value);
+    ProfileWriter &append_hex(uint64_t value);
+    // 刷新缓冲并原子替换目标文件
+    int commit();
+    // 放弃写入，删除临时文件
+    void abort();
+    uint64_t bytes() const
+    {
+        return written + buffer.size();
+    }
+
+private:
+    int flush();
+
+    std::string path;
+    std::string tmp_path;
+    int fd = -1;
+    bool failed = false;
+    uint64_t written = 0;
+    std::string buffer;
+};
+
+#endif
@@ -12,22 +12,102 @@
 #ifndef __RECORDS_H__
 #define __RECORDS_H__
 
+#include <atomic>
+#include <memory>
+
 #include "configs.h"
+#include "flat_map.h"
+#include "sample_batch.h"
+
+// pid超过该时间未出现在采样中，才检查其进程是否退出，单位ms
+#define PID_IDLE_TIME 10000
+// 清理已退出pid的检查周期，单位ms
+#define PID_SWEEP_PERIOD 10000
+// pid表满时一次淘汰的记录数为容量的1/PID_EVICT_RATIO，摊薄每次淘汰的全表遍历开销
+#define PID_EVICT_RATIO 10
+// Pidinfo按块分配，每块包含的对象数
+#define PIDINFO_CHUNK_SIZE 1024
 
 typedef struct {
     BinaryInstance *instance;
     pid_t pid;
-    int64_t ts;
+    int64_t ts;                 // 最近一次出现在采样中的时间
+    uint64_t starttime;         // 进程启动时间（/proc/<pid>/stat），仅目标应用记录，用于识别pid复用
+    char comm[SAMPLE_COMM_LEN]; // 进程名，采样进程名变化说明pid已被复用
 } Pidinfo;
 
+// Pidinfo的slab分配器，按块申请内存，释放的对象进入空闲链表复用
+class PidinfoPool {
+public:
+    Pidinfo *alloc();
+    void free(Pidinfo *info);
+    void clear();
+
+private:
+    std::vector<std::unique_ptr<Pidinfo[]>> chunks;
+    std::vector<Pidinfo *> free_list;
+    size_t chunk_used = PIDINFO_CHUNK_SIZE;
+};
+
+// 有界pid表，定期清理已退出的pid，表满时批量淘汰最久未出现的pid
+class PidTable {
+public:
+    void init(size_t capacity);
+    Pidinfo *find(pid_t pid)
+    {
+        Pidinfo **info = table.find((uint64_t)pid);
+        return info == nullptr ? nullptr : *info;
+    }
+    // 新建pid记录，表满时先淘汰
+    Pidinfo *insert(pid_t pid, int64_t now);
+    void erase(pid_t pid);
+    void clear();
+    size_t size() const
+    {
+        return table.size();
+    }
+    // 清理空闲超过idle_time且进程已退出或pid已被复用的记录，返回清理数量
+    size_t sweep(int64_t now, int64_t idle_time);
+
+    template <typename F>
+    void for_each(F func) const
+    {
+        table.for_each([&func](uint64_t, Pidinfo *info) { func(info); });
+    }
+
+private:
+    void evict_oldest(size_t count);
+
+    FlatMap<Pidinfo *> table;
+    PidinfoPool pool;
+    size_t capacity = DEFAULT_COLLECTOR_MAX_PIDS;
+    int64_t last_full_sweep = 0; // 表满触发的最近一次清理时间
+};
+
+// 模块分类结果，按模块路径内容缓存，不依赖libkperf字符串的地址和生命周期
+typedef struct {
+    std::string path;
+    AppConfig *app; // 模块所属的目标应用，非目标应用模块为nullptr
+    bool optimized; // 是否为BOLT优化后的.rto模块
+} ModuleInfo;
+
 typedef struct {
     uint64_t processed_samples;
-    std::map<pid_t, Pidinfo*> pids;
-    std::map<const char*, bool> modules;
+    std::atomic<uint64_t> queued_batches;  // 进入聚合队列的批次数
+    std::atomic<uint64_t> dropped_batches; // 聚合队列满被丢弃的批次数
+    std::atomic<uint64_t> dropped_samples; // 聚合队列满被丢弃的采样数
+    std::atomic<uint64_t> queue_depth;     // 聚合队列当前深度
+    std::atomic<uint64_t> queue_depth_max; // 聚合队列历史最大深度，用于评估队列大小
+    std::atomic<uint64_t> evicted_pids;    // 从pid表中淘汰的pid数
+    std::atomic<uint64_t> reused_pids;     // 检测到被复用的pid数
+    int64_t last_pid_sweep;                // 上一次清理pid表的时间
+    PidTable pids;
+    FlatMap<ModuleInfo> modules;           // 模块路径hash -> 模块分类，出现新实例时失效
 } global_records;
 
 extern global_records records;
 
+extern uint64_t hash_module_path(const char *path);
 extern void reset_records();
 extern void debug_print_records();
 
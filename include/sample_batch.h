@@ -0,0 +1,68 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __SAMPLE_BATCH_H__
+#define __SAMPLE_BATCH_H__
+
+#include <cstdint>
+#include <vector>
+#include <sys/types.h>
+
+#include "flat_map.h"
+
+// 进程名长度上限，与内核TASK_COMM_LEN一致
+#define SAMPLE_COMM_LEN 16
+// 字符串池中不存在的字符串（如libkperf未给出符号名）
+#define SAMPLE_NO_STRING UINT32_MAX
+
+// 批次内的进程，按pid去重
+typedef struct {
+    pid_t pid;
+    int64_t ts; // 该进程在批次内第一条采样的时间戳
+    char comm[SAMPLE_COMM_LEN];
+} SampleProc;
+
+// 批次内的符号，按libkperf的symbol去重，字段按值复制
+typedef struct {
+    uint64_t addr;   // symbol->codeMapAddr
+    uint64_t offset; // symbol->offset
+    uint32_t module; // 模块在modules中的下标
+    uint32_t name;   // mangleName在strings中的偏移
+} SampleSymbol;
+
+// 聚合所需的单条采样，进程和符号以批次内下标引用
+typedef struct {
+    int64_t ts;
+    uint32_t proc;
+    uint32_t symbol;
+} SampleRecord;
+
+// 一次UpdateData收到的采样数据，入队时从oeAware的DataList中按值提取，
+// 不持有libkperf符号缓存或采样数据的指针，退订或采样数据释放后仍可安全处理
+typedef struct {
+    std::vector<SampleRecord> samples;
+    std::vector<SampleProc> procs;
+    std::vector<SampleSymbol> symbols;
+    std::vector<uint32_t> modules; // 模块路径在strings中的偏移
+    std::vector<char> strings;     // 字符串池，每个字符串以'\0'结尾
+
+    // 以下仅入队线程使用：pid、symbol指针、模块路径hash -> 批次内下标
+    FlatMap<uint32_t> proc_index;
+    FlatMap<uint32_t> symbol_index;
+    FlatMap<uint32_t> module_index;
+} SampleBatch;
+
+static inline const char *sample_string(const SampleBatch &batch, uint32_t offset)
+{
+    return offset == SAMPLE_NO_STRING ? nullptr : batch.strings.data() + offset;
+}
+
+#endif
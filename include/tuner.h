@@ -16,6 +16,8 @@
 #include <oeaware/topic.h>
 #include <oeaware/interface.h>
 
+#include "pipeline.h"
+
 class SysboostTuner : public oeaware::Interface {
 public:
     SysboostTuner();
@@ -28,9 +30,13 @@ public:
     void Run() override;
 
 private:
+    void UpdateSampling();
+    void StopWorkers();
+
     oeaware::Topic depTopic;
-    void *processingArea;
-    size_t processingAreaSize;
+    bool subscribed = false;        // 是否已订阅采样数据
+    int64_t lastLoadCheck = 0;      // 采样策略1上一次检查应用负载的时间
+    AggregationPipeline pipeline;
 };
 
 #endif
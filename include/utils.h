@@ -17,19 +17,17 @@
 #include <mutex>
 
 #include "configs.h"
+#include "process_runner.h"
 
 #define INVALID_PID -1
 
-typedef struct {
-    std::string cmd_log;
-    int ret;
-} exec_result;
-
+extern std::string get_bin_build_id(std::string full_path);
 extern bool get_real_path(const char* path, char* resolved);
-extern exec_result exec_cmd(std::string cmd);
 extern time_t get_file_create_time(std::string file_path);
 extern std::string turn_timestamp_to_format_time(int64_t timestamp);
 extern int64_t get_current_timestamp();
 extern std::string get_bin_full_path_by_pid(pid_t pid);
+extern uint64_t get_process_start_time(pid_t pid);
+extern uint64_t get_process_cpu_time(pid_t pid);
 
 #endif
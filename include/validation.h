@@ -0,0 +1,93 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __VALIDATION_H__
+#define __VALIDATION_H__
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <sys/types.h>
+
+// 验证结果记录文件：<TUNER_PROFILE_DIR>/<app_name>.validation
+#define VALIDATION_FILE_SUFFIX ".validation"
+// 应用未运行或版本不符时，重新检查目标进程的间隔，单位ms
+#define VALIDATION_CHECK_PERIOD 5000
+// 窗口内应用CPU使用率低于该值时数据不具代表性，单位%
+#define VALIDATION_MIN_CPU_USAGE 5.0
+// 窗口内指令数下限，指令数过少时CPI波动较大
+#define VALIDATION_MIN_INSTRUCTIONS 100000000ULL
+// 两个窗口的CPU使用率之比不超过该值才视为负载可比
+#define VALIDATION_LOAD_RATIO 2.0
+
+// 一个测量窗口的性能数据
+typedef struct {
+    int64_t ts;            // 窗口结束时间
+    uint64_t cycles;
+    uint64_t instructions;
+    double cpi;            // cycles / instructions，越小越好
+    double cpu_usage;      // 窗口内应用进程CPU使用率，单位%，多核累加
+} PerfWindow;
+
+// 单个优化版本的验证结果
+typedef struct {
+    unsigned int version;  // 优化版本，与BinaryInstance::version一致
+    PerfWindow baseline;   // 原始版本（version 0）的测量窗口
+    PerfWindow candidate;  // 优化版本的测量窗口
+    double change;         // CPI变化百分比，正数表示性能下降
+    bool rolled_back;      // 是否已因性能下降提交回退任务
+} ValidationResult;
+
+// 基于libkperf计数模式的cycles/instructions计数器，绑定单个进程
+class PerfCounter {
+public:
+    PerfCounter() = default;
+    PerfCounter(const PerfCounter &) = delete;
+    PerfCounter &operator=(const PerfCounter &) = delete;
+    ~PerfCounter()
+    {
+        close();
+    }
+
+    int open(pid_t target);
+    void close();
+    bool opened() const
+    {
+        return pd >= 0;
+    }
+    pid_t target() const
+    {
+        return pid;
+    }
+    // 读取open以来的累计计数
+    int read(uint64_t *cycles, uint64_t *instructions);
+
+private:
+    int pd = -1;
+    pid_t pid = -1;
+};
+
+// 应用的优化效果验证状态，由tuner线程访问
+// optimized_rounds由优化任务线程在优化成功后递增，大于validated_rounds表示有待验证的优化版本
+typedef struct {
+    std::atomic<unsigned int> optimized_rounds{0};
+    unsigned int validated_rounds = 0;
+    PerfCounter counter;
+    bool candidate = false;       // 当前窗口测量的是否为优化版本
+    int64_t window_start = 0;
+    uint64_t window_cpu_time = 0; // 窗口开始时进程累计的CPU时间，单位clock tick
+    int64_t last_check = 0;
+    bool has_baseline = false;
+    PerfWindow baseline{};        // 最近一次原始版本的有效测量窗口
+    std::vector<ValidationResult> results;
+} AppValidation;
+
+#endif
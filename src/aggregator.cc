@@ -0,0 +1,129 @@
+#include "aggregator.h"
+
+ShardedAggregator sharded_aggregator;
+
+void ShardedAggregator::start(int threads)
+{
+    stop();
+    // 分片0始终由调用线程处理，单线程时不创建工作线程
+    partials.resize(threads > 1 ? threads : 1);
+    // 新工作线程从generation 0开始等待，需同时清空上次运行遗留的批次状态，
+    // 否则重新使能后工作线程会立即处理已释放的旧批次
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = false;
+        generation = 0;
+        pending = 0;
+        batch = nullptr;
+        owners = nullptr;
+        shards = 1;
+    }
+
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(&ShardedAggregator::worker_loop, this, i);
+    }
+}
+
+void ShardedAggregator::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (auto &worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+    partials.clear();
+}
+
+size_t ShardedAggregator::aggregate(const SampleBatch &batch, const SampleOwners &owners)
+{
+    if (partials.empty()) {
+        partials.resize(1);
+    }
+    bool split = !workers.empty() && batch.samples.size() >= PARALLEL_AGGREGATION_MIN_SAMPLES;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        this->batch = &batch;
+        this->owners = &owners;
+        shards = split ? partials.size() : 1;
+        if (split) {
+            pending = workers.size();
+            generation++;
+        }
+    }
+    if (!split) {
+        build_partial(0);
+        return 1;
+    }
+    start_cv.notify_all();
+
+    build_partial(0);
+
+    std::unique_lock<std::mutex> lock(mtx);
+    done_cv.wait(lock, [this] { return pending == 0; });
+    return shards;
+}
+
+void ShardedAggregator::worker_loop(size_t index)
+{
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            start_cv.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+
+        build_partial(index);
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            pending--;
+        }
+        done_cv.notify_one();
+    }
+}
+
+// 过滤分片内不属于所在进程目标应用的采样，再按目标实例、地址合并
+void ShardedAggregator::build_partial(size_t index)
+{
+    PartialHistogram &part = partials[index];
+    part.targets.resize(owners->target_apps.size());
+    for (AddrHistogram &hist : part.targets) {
+        hist.index.clear_keep_capacity();
+        hist.entries.clear();
+    }
+
+    const std::vector<SampleRecord> &samples = batch->samples;
+    size_t begin = samples.size() * index / shards;
+    size_t end = samples.size() * (index + 1) / shards;
+    for (size_t i = begin; i < end; ++i) {
+        const SampleRecord &sample = samples[i];
+        uint32_t target = owners->proc_targets[sample.proc];
+        if (target == AGGREGATION_NO_OWNER) {
+            continue;
+        }
+        const SampleSymbol &symbol = batch->symbols[sample.symbol];
+        // 仅记录目标应用二进制（原始版本或.rto优化版本）内的采样
+        if (owners->module_apps[symbol.module] != owners->target_apps[target]) {
+            continue;
+        }
+        AddrHistogram &hist = part.targets[target];
+        bool inserted = false;
+        uint32_t &pos = hist.index.get_or_insert(symbol.addr, &inserted);
+        if (inserted) {
+            pos = (uint32_t)hist.entries.size();
+            hist.entries.push_back(AddrEntry{sample.symbol, sample.ts, 1});
+        } else {
+            hist.entries[pos].count++;
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+
+#include "logs.h"
+#include "autotune.h"
+
+// 内置的候选选项，分别调整基本块排序、函数排序、函数拆分和ICF
+static const char *builtin_candidates[] = {
+    "-reorder-blocks=ext-tsp -reorder-functions=hfsort -split-functions -split-all-cold "
+    "-icf=1 -use-gnu-stack --inline-all",
+    "-reorder-blocks=cache -reorder-functions=hfsort+ -split-functions -split-all-cold "
+    "-icf=1 -use-gnu-stack --inline-all",
+    "-reorder-blocks=ext-tsp -reorder-functions=pettis-hansen -split-functions "
+    "-icf=1 -use-gnu-stack",
+    "-reorder-blocks=ext-tsp -reorder-functions=hfsort+ -use-gnu-stack",
+};
+
+double autotune_mean_score(const AutotuneCandidate &candidate)
+{
+    if (candidate.scores.empty()) {
+        return 0;
+    }
+    return std::accumulate(candidate.scores.begin(), candidate.scores.end(), 0.0) / candidate.scores.size();
+}
+
+// 全部候选都达到验证轮数后，固定使用平均得分最好的候选；
+// 最好的候选仍超过回退阈值时固定使用会反复优化、回退，此时放弃优化
+static void update_pinned(AutotuneState &state)
+{
+    int best = -1;
+    state.pinned = -1;
+    state.exhausted = false;
+    for (size_t i = 0; i < state.candidates.size(); ++i) {
+        const AutotuneCandidate &candidate = state.candidates[i];
+        if (candidate.scores.size() < AUTOTUNE_TRIALS) {
+            return;
+        }
+        if (best < 0 || autotune_mean_score(candidate) < autotune_mean_score(state.candidates[best])) {
+            best = (int)i;
+        }
+    }
+    if (best >= 0 && autotune_mean_score(state.candidates[best]) <= state.threshold) {
+        state.pinned = best;
+    } else {
+        state.exhausted = true;
+    }
+}
+
+static void add_candidate(AutotuneState &state, const std::string &options)
+{
+    for (const AutotuneCandidate &candidate : state.candidates) {
+        if (candidate.options == options) {
+            return;
+        }
+    }
+    state.candidates.push_back(AutotuneCandidate{options, {}});
+}
+
+// 历史记录每行格式：<score>\t<options>，按选项字符串匹配候选，候选列表变化后仍可复用
+void autotune_init(AutotuneState &state, const std::string &base_options, const std::string &path,
+    double threshold)
+{
+    state.path = path;
+    state.candidates.clear();
+    state.active = -1;
+    state.pinned = -1;
+    state.threshold = threshold;
+    state.exhausted = false;
+    add_candidate(state, base_options);
+    for (const char *options : builtin_candidates) {
+        add_candidate(state, options);
+    }
+
+    std::ifstream file(path);
+    std::string line;
+    size_t restored = 0;
+    while (std::getline(file, line)) {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos) {
+            continue;
+        }
+        std::string options = line.substr(tab + 1);
+        for (AutotuneCandidate &candidate : state.candidates) {
+            if (candidate.options == options) {
+                candidate.scores.push_back(strtod(line.c_str(), nullptr));
+                restored++;
+                break;
+            }
+        }
+    }
+    update_pinned(state);
+    if (restored > 0) {
+        INFO("[enable] restored " << restored << " autotune records from " << path
+            << (state.pinned >= 0 ? ", converged" : "") << (state.exhausted ? ", all candidates regressed" : ""));
+    }
+}
+
+int autotune_select(const AutotuneState &state)
+{
+    if (state.exhausted) {
+        return -1;
+    }
+    if (state.pinned >= 0) {
+        return state.pinned;
+    }
+    int selected = 0;
+    for (size_t i = 1; i < state.candidates.size(); ++i) {
+        if (state.candidates[i].scores.size() < state.candidates[selected].scores.size()) {
+            selected = (int)i;
+        }
+    }
+    return selected;
+}
+
+bool autotune_record(AutotuneState &state, double score)
+{
+    if (state.active < 0 || state.active >= (int)state.candidates.size()) {
+        return false;
+    }
+    AutotuneCandidate &candidate = state.candidates[state.active];
+    candidate.scores.push_back(score);
+    std::ofstream file(state.path, std::ios::app);
+    if (file.is_open()) {
+        file << score << "\t" << candidate.options << "\n";
+    } else {
+        WARN("[run] record autotune history to " << state.path << " failed");
+    }
+
+    int pinned = state.pinned;
+    update_pinned(state);
+    return state.pinned >= 0 && state.pinned != pinned;
+}
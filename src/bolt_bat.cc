@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cstring>
+#include <elf.h>
+
+#include "logs.h"
+#include "elf_symbols.h"
+#include "bolt_bat.h"
+
+// 按名称查找section，未找到返回nullptr
+static const Elf64_Shdr *find_section(const MappedFile &elf, const char *name)
+{
+    const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)elf.data;
+    if (elf.size < sizeof(Elf64_Ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr->e_ident[EI_CLASS] != ELFCLASS64 || ehdr->e_shentsize != sizeof(Elf64_Shdr) ||
+        ehdr->e_shoff + (uint64_t)ehdr->e_shnum * sizeof(Elf64_Shdr) > elf.size ||
+        ehdr->e_shstrndx >= ehdr->e_shnum) {
+        return nullptr;
+    }
+    const Elf64_Shdr *shdrs = (const Elf64_Shdr *)(elf.data + ehdr->e_shoff);
+    const Elf64_Shdr &strsec = shdrs[ehdr->e_shstrndx];
+    if (strsec.sh_offset + strsec.sh_size > elf.size) {
+        return nullptr;
+    }
+    const char *strtab = (const char *)(elf.data + strsec.sh_offset);
+    size_t len = strlen(name) + 1;
+    for (uint16_t i = 0; i < ehdr->e_shnum; ++i) {
+        if (shdrs[i].sh_name + len <= strsec.sh_size && memcmp(strtab + shdrs[i].sh_name, name, len) == 0) {
+            return shdrs[i].sh_offset + shdrs[i].sh_size <= elf.size ? &shdrs[i] : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+// 顺序读取BAT数据，越界时置错误标记
+typedef struct {
+    const uint8_t *pos;
+    const uint8_t *end;
+    bool error;
+} BatReader;
+
+template<typename T>
+static T read_value(BatReader &reader)
+{
+    T value = 0;
+    if (reader.error || (size_t)(reader.end - reader.pos) < sizeof(T)) {
+        reader.error = true;
+        return value;
+    }
+    memcpy(&value, reader.pos, sizeof(T));
+    reader.pos += sizeof(T);
+    return value;
+}
+
+int BoltAddressTranslation::load(const std::string &binary)
+{
+    std::string identity = get_file_identity(binary);
+    if (identity == "") {
+        return DFOT_ERROR;
+    }
+    if (identity == bin_identity) {
+        return DFOT_OK;
+    }
+    unload();
+
+    MappedFile elf{nullptr, 0};
+    if (map_file(binary, &elf) != DFOT_OK) {
+        ERROR("[run] map " << binary << " failed: " << strerror(errno));
+        return DFOT_ERROR;
+    }
+    const Elf64_Shdr *section = find_section(elf, BAT_SECTION_NAME);
+    if (section == nullptr) {
+        WARN("[run] " << binary << " has no " << BAT_SECTION_NAME << " section");
+        unmap_file(&elf);
+        return DFOT_ERROR;
+    }
+
+    // note头：namesz, descsz, type，name按4字节对齐
+    BatReader reader{elf.data + section->sh_offset, elf.data + section->sh_offset + section->sh_size, false};
+    uint32_t namesz = read_value<uint32_t>(reader);
+    uint32_t descsz = read_value<uint32_t>(reader);
+    read_value<uint32_t>(reader);
+    size_t name_len = (namesz + 3) & ~3U;
+    if (reader.error || (size_t)(reader.end - reader.pos) < name_len + descsz ||
+        namesz != sizeof(BAT_NOTE_NAME) || memcmp(reader.pos, BAT_NOTE_NAME, namesz) != 0) {
+        ERROR("[run] invalid BAT note in " << binary);
+        unmap_file(&elf);
+        return DFOT_ERROR;
+    }
+    reader.pos += name_len;
+    reader.end = reader.pos + descsz;
+
+    // 函数表：NumFuncs, {Address(u64), NumEntries(u32), {OutputOffset(u32), InputOffset(u32)}...}...
+    uint32_t num_funcs = read_value<uint32_t>(reader);
+    for (uint32_t i = 0; i < num_funcs && !reader.error; ++i) {
+        uint64_t addr = read_value<uint64_t>(reader);
+        uint32_t count = read_value<uint32_t>(reader);
+        if ((size_t)(reader.end - reader.pos) < (size_t)count * sizeof(BatEntry)) {
+            reader.error = true;
+            break;
+        }
+        functions.push_back(BatFunction{addr, (uint32_t)entries.size(), count});
+        for (uint32_t j = 0; j < count; ++j) {
+            uint32_t output_offset = read_value<uint32_t>(reader);
+            uint32_t input_offset = read_value<uint32_t>(reader);
+            entries.push_back(BatEntry{output_offset, input_offset});
+        }
+    }
+    // 冷片段表：NumColdEntries, {ColdAddress(u64), HotAddress(u64)}...
+    uint32_t num_cold = read_value<uint32_t>(reader);
+    for (uint32_t i = 0; i < num_cold && !reader.error; ++i) {
+        uint64_t cold_addr = read_value<uint64_t>(reader);
+        uint64_t hot_addr = read_value<uint64_t>(reader);
+        cold_parts.push_back(BatColdPart{cold_addr, hot_addr});
+    }
+    unmap_file(&elf);
+
+    // 新版本LLVM的BAT为变长编码，长度不能恰好匹配时按不支持处理
+    if (reader.error || reader.pos != reader.end) {
+        WARN("[run] unsupported BAT format in " << binary);
+        unload();
+        return DFOT_ERROR;
+    }
+
+    std::sort(functions.begin(), functions.end(),
+        [](const BatFunction &a, const BatFunction &b) { return a.addr < b.addr; });
+    for (const BatFunction &func : functions) {
+        std::sort(entries.begin() + func.begin, entries.begin() + func.begin + func.count,
+            [](const BatEntry &a, const BatEntry &b) { return a.output_offset < b.output_offset; });
+    }
+    std::sort(cold_parts.begin(), cold_parts.end(),
+        [](const BatColdPart &a, const BatColdPart &b) { return a.cold_addr < b.cold_addr; });
+
+    bin_identity = identity;
+    INFO("[run] loaded BAT of " << binary << ": " << functions.size() << " functions, "
+        << cold_parts.size() << " cold parts");
+    return DFOT_OK;
+}
+
+void BoltAddressTranslation::unload()
+{
+    bin_identity = "";
+    functions.clear();
+    entries.clear();
+    cold_parts.clear();
+}
+
+// 取不大于offset的最后一个映射点，原始偏移 = 映射点输入偏移 + 与映射点的距离
+uint64_t BoltAddressTranslation::translate(uint64_t func_addr, uint64_t offset) const
+{
+    auto func = std::lower_bound(functions.begin(), functions.end(), func_addr,
+        [](const BatFunction &f, uint64_t addr) { return f.addr < addr; });
+    if (func == functions.end() || func->addr != func_addr) {
+        return offset;
+    }
+    auto begin = entries.begin() + func->begin;
+    auto end = begin + func->count;
+    auto it = std::upper_bound(begin, end, offset,
+        [](uint64_t value, const BatEntry &entry) { return value < entry.output_offset; });
+    if (it == begin) {
+        return offset;
+    }
+    --it;
+    return offset - it->output_offset + (it->input_offset & ~BAT_BRANCH_ENTRY);
+}
+
+uint64_t BoltAddressTranslation::parent(uint64_t func_addr) const
+{
+    auto it = std::lower_bound(cold_parts.begin(), cold_parts.end(), func_addr,
+        [](const BatColdPart &part, uint64_t addr) { return part.cold_addr < addr; });
+    if (it == cold_parts.end() || it->cold_addr != func_addr) {
+        return func_addr;
+    }
+    return it->hot_addr;
+}
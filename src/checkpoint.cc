@@ -0,0 +1,207 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "logs.h"
+#include "utils.h"
+#include "elf_symbols.h"
+#include "checkpoint.h"
+
+static std::string get_checkpoint_path(AppConfig *app)
+{
+    return configs->tuner_profile_dir + "/" + app->app_name + CHECKPOINT_SUFFIX;
+}
+
+static uint64_t checksum_entries(const CheckpointEntry *entries, size_t count)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const unsigned char *p = (const unsigned char *)entries;
+    for (size_t i = 0; i < count * sizeof(CheckpointEntry); ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static int write_all(int fd, const void *data, size_t len)
+{
+    const char *pos = (const char *)data;
+    while (len > 0) {
+        ssize_t ret = write(fd, pos, len);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return DFOT_ERROR;
+        }
+        pos += ret;
+        len -= ret;
+    }
+    return DFOT_OK;
+}
+
+// 重新创建只有文件头的检查点
+static int reset_checkpoint(AppConfig *app, const std::string &path)
+{
+    std::string identity = get_bin_identity(app->full_path);
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    memcpy(header.identity, identity.data(), std::min(identity.size(), sizeof(header.identity)));
+    header.ts = app->profile.ts;
+
+    std::string tmp_path = path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ERROR("[run] open " << tmp_path << " error: " << strerror(errno));
+        return DFOT_ERROR;
+    }
+    int ret = write_all(fd, &header, sizeof(header));
+    close(fd);
+    if (ret != DFOT_OK || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        ERROR("[run] reset checkpoint " << path << " error");
+        unlink(tmp_path.c_str());
+        return DFOT_ERROR;
+    }
+    return DFOT_OK;
+}
+
+int checkpoint_app_profile(AppConfig *app)
+{
+    Profile &profile = app->profile;
+    app->last_checkpoint = get_current_timestamp();
+    std::string path = get_checkpoint_path(app);
+
+    // 只保存原始二进制的采样，优化版本的地址随.rto变化，恢复后无法复用
+    if (app->instances.size() != 1) {
+        unlink(path.c_str());
+        profile.ckpt_reset = true;
+        return DFOT_OK;
+    }
+    if (profile.ckpt_reset) {
+        if (reset_checkpoint(app, path) != DFOT_OK) {
+            return DFOT_ERROR;
+        }
+        profile.ckpt_reset = false;
+        profile.ckpt_erased.clear();
+        profile.addrs.for_each([](uint64_t, AddrInfo &info) {
+            info.saved = 0;
+        });
+    }
+
+    std::vector<CheckpointEntry> entries;
+    for (const auto &erased : profile.ckpt_erased) {
+        entries.push_back(CheckpointEntry{erased.first, -(int64_t)erased.second});
+    }
+    profile.addrs.for_each([&entries](uint64_t addr, const AddrInfo &info) {
+        if (info.count != info.saved) {
+            entries.push_back(CheckpointEntry{addr, (int64_t)info.count - info.saved});
+        }
+    });
+    if (entries.empty()) {
+        return DFOT_OK;
+    }
+
+    // 段头和数据一次写入，写入中途异常时由校验和识别不完整的段
+    std::string segment(sizeof(CheckpointSegment) + entries.size() * sizeof(CheckpointEntry), '\0');
+    CheckpointSegment *head = (CheckpointSegment *)&segment[0];
+    head->magic = CHECKPOINT_SEGMENT_MAGIC;
+    head->count = entries.size();
+    head->checksum = checksum_entries(entries.data(), entries.size());
+    memcpy(&segment[sizeof(CheckpointSegment)], entries.data(), entries.size() * sizeof(CheckpointEntry));
+
+    int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd < 0) {
+        ERROR("[run] open " << path << " error: " << strerror(errno));
+        profile.ckpt_reset = true;
+        return DFOT_ERROR;
+    }
+    int ret = write_all(fd, segment.data(), segment.size());
+    if (ret == DFOT_OK) {
+        ret = fdatasync(fd) == 0 ? DFOT_OK : DFOT_ERROR;
+    }
+    close(fd);
+    if (ret != DFOT_OK) {
+        ERROR("[run] append checkpoint " << path << " error");
+        profile.ckpt_reset = true;
+        return DFOT_ERROR;
+    }
+
+    profile.ckpt_erased.clear();
+    profile.addrs.for_each([](uint64_t, AddrInfo &info) {
+        info.saved = info.count;
+    });
+    DEBUG("[run] checkpoint " << entries.size() << " addrs of " << app->app_name);
+    return DFOT_OK;
+}
+
+int restore_app_profile(AppConfig *app)
+{
+    std::string path = get_checkpoint_path(app);
+    MappedFile file{nullptr, 0};
+    if (map_file(path, &file) != DFOT_OK) {
+        return DFOT_OK;
+    }
+
+    const CheckpointHeader *header = (const CheckpointHeader *)file.data;
+    std::string identity = get_bin_identity(app->full_path);
+    if (file.size < sizeof(CheckpointHeader) ||
+        memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0 ||
+        identity.size() != sizeof(header->identity) ||
+        memcmp(header->identity, identity.data(), sizeof(header->identity)) != 0) {
+        INFO("[enable] binary of " << app->app_name << " changed, discard checkpoint " << path);
+        unmap_file(&file);
+        unlink(path.c_str());
+        return DFOT_OK;
+    }
+
+    // 依次合并增量段，遇到不完整的段即停止
+    FlatMap<int64_t> counts;
+    size_t pos = sizeof(CheckpointHeader);
+    size_t segments = 0;
+    while (pos + sizeof(CheckpointSegment) <= file.size) {
+        const CheckpointSegment *segment = (const CheckpointSegment *)(file.data + pos);
+        size_t len = sizeof(CheckpointSegment) + (size_t)segment->count * sizeof(CheckpointEntry);
+        if (segment->magic != CHECKPOINT_SEGMENT_MAGIC || pos + len > file.size) {
+            break;
+        }
+        const CheckpointEntry *entries = (const CheckpointEntry *)(segment + 1);
+        if (checksum_entries(entries, segment->count) != segment->checksum) {
+            break;
+        }
+        for (uint32_t i = 0; i < segment->count; ++i) {
+            counts[entries[i].addr] += entries[i].delta;
+        }
+        pos += len;
+        segments++;
+    }
+    int64_t ts = header->ts;
+    bool truncated = pos != file.size;
+    unmap_file(&file);
+    // 截断末尾的损坏数据，保证后续追加的段可以被正确解析
+    if (truncated && truncate(path.c_str(), pos) != 0) {
+        WARN("[enable] truncate checkpoint " << path << " error: " << strerror(errno));
+    }
+
+    // 恢复的地址按未解析处理，后续采样带有符号时补记函数，其余在导出时通过符号索引批量解析
+    std::lock_guard<std::mutex> lock(app->profile_mtx);
+    profile_clear(app->profile);
+    app->profile.ts = ts;
+    // 分桶模式下恢复的数据计入当前时间桶，随时间桶正常老化
+    profile_advance_window(app->profile, app->window, get_current_timestamp());
+    counts.for_each([app](uint64_t addr, int64_t count) {
+        if (count > 0) {
+            app->profile.addrs[addr] = AddrInfo{UNRESOLVED_SYMBOL_ID, 0, (int)count, (int)count};
+            profile_window_add(app->profile, app->window, addr, (int)count);
+        }
+    });
+    app->profile.ckpt_reset = false;
+    if (app->profile.addrs.size() > 0 && app->instances.empty()) {
+        app->instances.push_back(new BinaryInstance{app, 0, app->full_path,
+            get_file_create_time(app->full_path), app->build_id});
+    }
+    INFO("[enable] restored " << app->profile.addrs.size() << " addrs of " << app->app_name
+        << " from " << segments << " checkpoint segments");
+    return DFOT_OK;
+}
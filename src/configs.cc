@@ -8,6 +8,7 @@
 #include "utils.h"
 #include "logs.h"
 #include "configs.h"
+#include "process_tracker.h"
 
 GlobalConfig *configs = nullptr;
 
@@ -38,33 +39,83 @@ void debug_print_configs()
           << configs->sampling_strategy);
     DEBUG("[DFOT_CONFIG] COLLECTOR_HIGH_LOAD_THRESHOLD: "
           << configs->high_load_threshold);
+    DEBUG("[DFOT_CONFIG] COLLECTOR_HIGH_LOAD_HYSTERESIS: "
+          << configs->high_load_hysteresis);
+    DEBUG("[DFOT_CONFIG] COLLECTOR_HIGH_LOAD_CHECK_PERIOD: "
+          << configs->high_load_check_period);
     DEBUG("[DFOT_CONFIG] COLLECTOR_SAMPLING_PERIOD    : "
           << configs->collector_sampling_period);
     DEBUG("[DFOT_CONFIG] COLLECTOR_SAMPLING_FREQ      : "
           << configs->collector_sampling_freq);
     DEBUG("[DFOT_CONFIG] COLLECTOR_DATA_AGING_TIME    : "
           << configs->collector_data_aging_time);
+    DEBUG("[DFOT_CONFIG] COLLECTOR_QUEUE_SIZE         : "
+          << configs->collector_queue_size);
+    DEBUG("[DFOT_CONFIG] COLLECTOR_QUEUE_BLOCK_TIME   : "
+          << configs->collector_queue_block_time);
+    DEBUG("[DFOT_CONFIG] COLLECTOR_AGGREGATION_THREADS: "
+          << configs->collector_aggregation_threads);
+    DEBUG("[DFOT_CONFIG] COLLECTOR_MAX_PIDS           : "
+          << configs->collector_max_pids);
+    DEBUG("[DFOT_CONFIG] COLLECTOR_MATCH_EXE_PATH     : "
+          << configs->collector_match_exe_path);
+    DEBUG("[DFOT_CONFIG] COLLECTOR_CHECKPOINT_PERIOD  : "
+          << configs->collector_checkpoint_period);
     DEBUG("[DFOT_CONFIG] TUNER_TOOL                   : "
           << configs->tuner_tool);
     DEBUG("[DFOT_CONFIG] TUNER_CHECK_PERIOD           : "
           << configs->tuner_check_period);
     DEBUG("[DFOT_CONFIG] TUNER_PROFILE_DIR            : "
           << configs->tuner_profile_dir);
+    DEBUG("[DFOT_CONFIG] TUNER_PROFILE_HISTORY        : "
+          << configs->tuner_profile_history);
     DEBUG("[DFOT_CONFIG] TUNER_OPTIMIZING_STRATEGY    : "
           << configs->tuner_optimizing_strategy);
     DEBUG("[DFOT_CONFIG] TUNER_OPTIMIZING_CONDITION   : "
           << configs->tuner_optimizing_condition);
+    DEBUG("[DFOT_CONFIG] TUNER_OPTIMIZING_JOBS        : "
+          << configs->tuner_optimizing_jobs);
+    DEBUG("[DFOT_CONFIG] TUNER_OPTIMIZING_TIMEOUT     : "
+          << configs->tuner_optimizing_timeout);
+    DEBUG("[DFOT_CONFIG] TUNER_OPTIMIZING_NICE        : "
+          << configs->tuner_optimizing_nice);
+    DEBUG("[DFOT_CONFIG] TUNER_OPTIMIZING_CPUS        : "
+          << configs->tuner_optimizing_cpus);
+    DEBUG("[DFOT_CONFIG] TUNER_OPTIMIZING_CGROUP      : "
+          << configs->tuner_optimizing_cgroup);
+    DEBUG("[DFOT_CONFIG] TUNER_OPTIMIZING_MEMORY_LIMIT: "
+          << configs->tuner_optimizing_memory_limit);
+    DEBUG("[DFOT_CONFIG] TUNER_VALIDATION_THRESHOLD   : "
+          << configs->tuner_validation_threshold);
+    DEBUG("[DFOT_CONFIG] TUNER_VALIDATION_WINDOW      : "
+          << configs->tuner_validation_window);
+    DEBUG("[DFOT_CONFIG] TUNER_LOW_LOAD               : "
+          << "threshold: " << configs->tuner_low_load.threshold
+          << "%, psi: " << configs->tuner_low_load.psi_threshold
+          << "%, hysteresis: " << configs->tuner_low_load.hysteresis
+          << "%, quiet time: " << configs->tuner_low_load.quiet_time << "ms");
 
     for (auto it = configs->apps.begin(); it != configs->apps.end(); ++it) {
         AppConfig *app = *it;
         DEBUG("-------------------------------------------------------");
         DEBUG("[DFOT_CONFIG] APP                : " << app->app_name);
         DEBUG("[DFOT_CONFIG] FULL_PATH          : " << app->full_path);
+        DEBUG("[DFOT_CONFIG] BUILD_ID           : " << app->build_id);
         DEBUG("[DFOT_CONFIG] DEFAULT_PROFILE    : " << app->default_profile);
         DEBUG("[DFOT_CONFIG] DUMP_DATA_THRESHOLD: " << app->collector_dump_data_threshold);
         DEBUG("[DFOT_CONFIG] BOLT_DIR           : " << app->bolt_dir);
         DEBUG("[DFOT_CONFIG] BOLT_OPTIONS       : " << app->bolt_options);
         DEBUG("[DFOT_CONFIG] UPDATE_DEBUG_INFO  : " << app->update_debug_info);
+        DEBUG("[DFOT_CONFIG] BOLT_HOT_COVERAGE  : " << app->hot_coverage);
+        DEBUG("[DFOT_CONFIG] BOLT_AUTOTUNE      : " << app->autotune.enabled
+            << " (candidates: " << app->autotune.candidates.size() << ")");
+        DEBUG("[DFOT_CONFIG] PROFILE_WINDOW_MODE: " << app->window.mode
+            << " (buckets: " << app->window.buckets << ", decay: " << app->window.decay_factor << ")");
+        DEBUG("[DFOT_CONFIG] PROFILE_CONVERGENCE: " << app->convergence.enabled
+            << " (top: " << app->convergence.top_n << ", similarity: " << app->convergence.similarity
+            << ", rounds: " << app->convergence.stable_rounds << ", interval: " << app->convergence.interval
+            << ", samples: [" << app->convergence.min_samples << ", " << app->convergence.max_samples << "])");
+        DEBUG("[DFOT_CONFIG] CUMULATIVE_WEIGHT  : " << app->cumulative_weight);
     }
     DEBUG("---------------------------------------------------------------");
 }
@@ -84,12 +135,53 @@ int parse_general(boost::property_tree::ptree pt)
         dfot_logger.setLogLevel(configs->log_level);
         configs->sampling_strategy             = pt.get<int>("general.COLLECTOR_SAMPLING_STRATEGY");
         configs->high_load_threshold           = pt.get<int>("general.COLLECTOR_HIGH_LOAD_THRESHOLD");
+        // 采样策略1的迟滞和检查周期为可选项
+        configs->high_load_hysteresis          = pt.get<int>("general.COLLECTOR_HIGH_LOAD_HYSTERESIS", 200);
+        configs->high_load_check_period        = pt.get<int>("general.COLLECTOR_HIGH_LOAD_CHECK_PERIOD", 5000);
+        if (configs->sampling_strategy < 0 || configs->sampling_strategy > 1 ||
+            configs->high_load_hysteresis < 0 || configs->high_load_hysteresis >= configs->high_load_threshold ||
+            configs->high_load_check_period <= 0) {
+            ERROR("invalid COLLECTOR_SAMPLING_STRATEGY or COLLECTOR_HIGH_LOAD_* configs");
+            return DFOT_ERROR;
+        }
         configs->collector_sampling_period     = pt.get<int>("general.COLLECTOR_SAMPLING_PERIOD");
         configs->collector_sampling_freq       = pt.get<int>("general.COLLECTOR_SAMPLING_FREQ");
         configs->collector_data_aging_time     = pt.get<int>("general.COLLECTOR_DATA_AGING_TIME");
+        // 聚合队列配置为可选项，兼容旧配置文件
+        configs->collector_queue_size          = pt.get<int>("general.COLLECTOR_QUEUE_SIZE",
+                                                             DEFAULT_COLLECTOR_QUEUE_SIZE);
+        configs->collector_queue_block_time    = pt.get<int>("general.COLLECTOR_QUEUE_BLOCK_TIME", 0);
+        if (configs->collector_queue_size <= 0 || configs->collector_queue_block_time < 0) {
+            ERROR("invalid COLLECTOR_QUEUE_SIZE or COLLECTOR_QUEUE_BLOCK_TIME");
+            return DFOT_ERROR;
+        }
+        configs->collector_aggregation_threads = pt.get<int>("general.COLLECTOR_AGGREGATION_THREADS", 1);
+        if (configs->collector_aggregation_threads <= 0) {
+            ERROR("invalid COLLECTOR_AGGREGATION_THREADS: " << configs->collector_aggregation_threads);
+            return DFOT_ERROR;
+        }
+        configs->collector_max_pids            = pt.get<int>("general.COLLECTOR_MAX_PIDS",
+                                                             DEFAULT_COLLECTOR_MAX_PIDS);
+        if (configs->collector_max_pids <= 0) {
+            ERROR("invalid COLLECTOR_MAX_PIDS: " << configs->collector_max_pids);
+            return DFOT_ERROR;
+        }
+        configs->collector_match_exe_path      = pt.get<int>("general.COLLECTOR_MATCH_EXE_PATH", 0) == 1;
+        configs->collector_checkpoint_period   = pt.get<int>("general.COLLECTOR_CHECKPOINT_PERIOD",
+                                                             DEFAULT_COLLECTOR_CHECKPOINT_PERIOD);
+        if (configs->collector_checkpoint_period < 0) {
+            ERROR("invalid COLLECTOR_CHECKPOINT_PERIOD: " << configs->collector_checkpoint_period);
+            return DFOT_ERROR;
+        }
         configs->tuner_tool                    = pt.get<std::string>("general.TUNER_TOOL");
         configs->tuner_check_period            = pt.get<int>("general.TUNER_CHECK_PERIOD");
         configs->tuner_profile_dir             = pt.get<std::string>("general.TUNER_PROFILE_DIR");
+        configs->tuner_profile_history         = pt.get<int>("general.TUNER_PROFILE_HISTORY",
+                                                             DEFAULT_TUNER_PROFILE_HISTORY);
+        if (configs->tuner_profile_history < 0) {
+            ERROR("invalid TUNER_PROFILE_HISTORY: " << configs->tuner_profile_history);
+            return DFOT_ERROR;
+        }
         int strategy = pt.get<int>("general.TUNER_OPTIMIZING_STRATEGY");
         if (strategy == 0) {
             configs->tuner_optimizing_strategy = OPTIMIZE_ONE_TIME;
@@ -97,6 +189,38 @@ int parse_general(boost::property_tree::ptree pt)
             configs->tuner_optimizing_strategy = OPTIMIZE_CONTINUOUS;
         }
         configs->tuner_optimizing_condition    = pt.get<int>("general.TUNER_OPTIMIZING_CONDITION");
+        // 优化任务执行配置为可选项，默认同时执行一个任务，以最低优先级运行
+        configs->tuner_optimizing_jobs         = pt.get<int>("general.TUNER_OPTIMIZING_JOBS", 1);
+        configs->tuner_optimizing_timeout      = pt.get<int>("general.TUNER_OPTIMIZING_TIMEOUT", 3600);
+        configs->tuner_optimizing_nice         = pt.get<int>("general.TUNER_OPTIMIZING_NICE", 19);
+        configs->tuner_optimizing_cpus         = pt.get<std::string>("general.TUNER_OPTIMIZING_CPUS", "");
+        configs->tuner_optimizing_cgroup       = pt.get<std::string>("general.TUNER_OPTIMIZING_CGROUP", "");
+        configs->tuner_optimizing_memory_limit = pt.get<int>("general.TUNER_OPTIMIZING_MEMORY_LIMIT", 0);
+        if (configs->tuner_optimizing_jobs <= 0 || configs->tuner_optimizing_timeout < 0 ||
+            configs->tuner_optimizing_memory_limit < 0 ||
+            configs->tuner_optimizing_nice < -20 || configs->tuner_optimizing_nice > 19 ||
+            configs->tuner_optimizing_cpus.find_first_not_of("0123456789,-") != std::string::npos) {
+            ERROR("invalid TUNER_OPTIMIZING_JOBS/TIMEOUT/NICE/CPUS/MEMORY_LIMIT");
+            return DFOT_ERROR;
+        }
+        configs->tuner_validation_threshold    = pt.get<double>("general.TUNER_VALIDATION_THRESHOLD", 0);
+        configs->tuner_validation_window       = pt.get<int>("general.TUNER_VALIDATION_WINDOW", 30000);
+        if (configs->tuner_validation_threshold < 0 || configs->tuner_validation_window <= 0) {
+            ERROR("invalid TUNER_VALIDATION_THRESHOLD/WINDOW");
+            return DFOT_ERROR;
+        }
+        // 低负载判定配置，仅在优化条件1和2下生效
+        LoadPolicy &low_load = configs->tuner_low_load;
+        low_load.threshold     = pt.get<double>("general.TUNER_LOW_LOAD_THRESHOLD", 30);
+        low_load.psi_threshold = pt.get<double>("general.TUNER_LOW_LOAD_PSI_THRESHOLD", 10);
+        low_load.hysteresis    = pt.get<double>("general.TUNER_LOW_LOAD_HYSTERESIS", 10);
+        low_load.quiet_time    = pt.get<int64_t>("general.TUNER_LOW_LOAD_QUIET_TIME", 60000);
+        if (configs->tuner_optimizing_condition < 0 || configs->tuner_optimizing_condition > 2 ||
+            low_load.threshold <= 0 || low_load.psi_threshold <= 0 || low_load.hysteresis < 0 ||
+            low_load.quiet_time < 0) {
+            ERROR("invalid TUNER_OPTIMIZING_CONDITION or TUNER_LOW_LOAD_* configs");
+            return DFOT_ERROR;
+        }
     } catch (const boost::property_tree::ptree_bad_path &e) {
         ERROR("Error accessing property: " << e.what());
         return DFOT_ERROR;
@@ -106,7 +230,7 @@ int parse_general(boost::property_tree::ptree pt)
 }
 
 
-// profile命名方式：<app_name>_<32bit_hash>_<dump_data_threshold>.profile
+// 中间文件前缀命名方式：<app_name>_<32bit_hash>_<dump_data_threshold>.profile
 // app_name: 二进制名
 // 32bit_hash: 二进制绝对路径的32bit hash值
 // dump_data_threshold: 收集数据阈值
@@ -148,9 +272,10 @@ int parse_app(boost::property_tree::ptree pt, std::string app_name)
     }
 
     app->full_path         = full_path;
+    app->build_id          = get_bin_build_id(full_path);
     app->app_name          = app_name;
     app->current_pid       = INVALID_PID;
-    app->profile.ts        = 0;
+    profile_clear(app->profile);
     app->status            = UNOPTIMIZED;
     app->collected_profile = "";
     app->bolt_options      = "";
@@ -211,13 +336,106 @@ int parse_app(boost::property_tree::ptree pt, std::string app_name)
         app->update_debug_info = false;
     }
 
-    // 初始化时即确定动态收集的profile文件路径，即使本轮未导出，如果有上一轮启动留下的profile也可以复用
+    app->hot_coverage = pt.get<double>(app_name + ".BOLT_HOT_COVERAGE", 0);
+    if (app->hot_coverage < 0 || app->hot_coverage > 100) {
+        ERROR(app_name << " has invalid BOLT_HOT_COVERAGE, it should be in [0, 100]");
+        return DFOT_ERROR;
+    }
+
+    // BOLT选项自动调优依据优化效果验证的结果打分，需要持续优化策略和验证功能
+    app->autotune.enabled = pt.get<int>(app_name + ".BOLT_AUTOTUNE", 0) == 1;
+    app->autotune.active = -1;
+    app->autotune.pinned = -1;
+    app->autotune.exhausted = false;
+    if (app->autotune.enabled) {
+        if (configs->tuner_optimizing_strategy != OPTIMIZE_CONTINUOUS || configs->tuner_validation_threshold <= 0) {
+            ERROR(app_name << " BOLT_AUTOTUNE requires TUNER_OPTIMIZING_STRATEGY = 1 "
+                "and TUNER_VALIDATION_THRESHOLD > 0");
+            return DFOT_ERROR;
+        }
+        autotune_init(app->autotune, app->bolt_options == "" ? DEFAULT_BOLT_OPTIONS : app->bolt_options,
+            configs->tuner_profile_dir + "/" + app_name + AUTOTUNE_FILE_SUFFIX, configs->tuner_validation_threshold);
+    }
+
+    // profile老化方式为可选配置，默认保持超过老化时间后整体丢弃
+    int window_mode = pt.get<int>(app_name + ".PROFILE_WINDOW_MODE", WINDOW_RESET);
+    app->window.buckets = pt.get<int>(app_name + ".PROFILE_WINDOW_BUCKETS", 6);
+    app->window.decay_factor = pt.get<double>(app_name + ".PROFILE_DECAY_FACTOR", 0.5);
+    if (window_mode < WINDOW_RESET || window_mode > WINDOW_DECAY || app->window.buckets <= 0 ||
+        app->window.decay_factor <= 0 || app->window.decay_factor >= 1) {
+        ERROR(app_name << " has invalid PROFILE_WINDOW_MODE/PROFILE_WINDOW_BUCKETS/PROFILE_DECAY_FACTOR");
+        return DFOT_ERROR;
+    }
+    app->window.mode = (PROFILE_WINDOW_MODE)window_mode;
+    app->window.epoch_len = configs->collector_data_aging_time / app->window.buckets;
+
+    // 收敛检测为可选配置，默认关闭，仅按COLLECTOR_DUMP_DATA_THRESHOLD导出
+    ProfileConvergence &conv = app->convergence;
+    conv.enabled = pt.get<int>(app_name + ".PROFILE_CONVERGENCE", 0) == 1;
+    conv.top_n = pt.get<int>(app_name + ".CONVERGENCE_TOP_N", 200);
+    conv.similarity = pt.get<double>(app_name + ".CONVERGENCE_SIMILARITY", 0.9);
+    conv.stable_rounds = pt.get<int>(app_name + ".CONVERGENCE_STABLE_ROUNDS", 3);
+    conv.interval = pt.get<int64_t>(app_name + ".CONVERGENCE_CHECK_INTERVAL", 10000);
+    conv.min_samples = pt.get<int64_t>(app_name + ".CONVERGENCE_MIN_SAMPLES", 10000);
+    conv.max_samples = pt.get<int64_t>(app_name + ".CONVERGENCE_MAX_SAMPLES", 0);
+    if (conv.top_n <= 0 || conv.similarity <= 0 || conv.similarity > 1 || conv.stable_rounds <= 0 ||
+        conv.interval < 0 || conv.min_samples < 0 || conv.max_samples < 0) {
+        ERROR(app_name << " has invalid CONVERGENCE_* configs");
+        return DFOT_ERROR;
+    }
+
+    // 累积模式依赖历史profile存储，上一轮的profile从存储中读取
+    app->last_checkpoint = 0;
+    app->cpu_times.clear();
+    app->cpu_ts = 0;
+    app->cpu_usage = 0;
+    app->cumulative_weight = pt.get<double>(app_name + ".PROFILE_CUMULATIVE_WEIGHT", 0);
+    if (app->cumulative_weight < 0 || app->cumulative_weight > 1) {
+        ERROR(app_name << " has invalid PROFILE_CUMULATIVE_WEIGHT, it should be in [0, 1]");
+        return DFOT_ERROR;
+    }
+
+    // 采集的profile按版本保存在TUNER_PROFILE_DIR下，该路径只作为perf2bolt转换中间文件的前缀
     app->collected_profile = get_app_collected_profile_path(app);
     configs->apps.push_back(app);
 
     return DFOT_OK;
 }
 
+// 构建应用索引，进程名按内核comm长度截断，与采样数据中的comm保持一致
+static void build_app_index()
+{
+    configs->comm_index.clear();
+    configs->path_index.clear();
+    for (AppConfig *app : configs->apps) {
+        std::string comm = app->app_name.substr(0, TASK_COMM_LEN - 1);
+        configs->comm_index[comm].push_back(app);
+        configs->path_index[app->full_path] = app;
+        configs->path_index[app->full_path + ".rto"] = app;
+    }
+}
+
+// 根据采样进程名匹配目标应用，进程名有歧义或开启路径匹配时通过/proc/<pid>/exe确认
+AppConfig *match_app(const char *comm, pid_t pid)
+{
+    auto it = configs->comm_index.find(comm);
+    if (it != configs->comm_index.end() && it->second.size() == 1 &&
+        it->second[0]->app_name.size() < TASK_COMM_LEN) {
+        return it->second[0];
+    }
+    if (it == configs->comm_index.end() && !configs->collector_match_exe_path) {
+        return nullptr;
+    }
+
+    // 进程名被截断后有多个候选，或进程名不匹配但开启了路径匹配，优先查询已跟踪的进程
+    TrackedProcess process;
+    if (process_tracker.lookup(pid, &process)) {
+        return process.app;
+    }
+    auto path = configs->path_index.find(get_bin_full_path_by_pid(pid));
+    return path == configs->path_index.end() ? nullptr : path->second;
+}
+
 // 解析ini文件并更新全局配置信息
 int parse_dfot_ini(std::string ini_path)
 {
@@ -254,6 +472,7 @@ int parse_dfot_ini(std::string ini_path)
             return DFOT_ERROR;
         }
     }
+    build_app_index();
 
     debug_print_configs();
     return DFOT_OK;
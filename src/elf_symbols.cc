@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <elf.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <boost/filesystem.hpp>
+
+#include "logs.h"
+#include "elf_symbols.h"
+
+int map_file(const std::string &path, MappedFile *file)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return DFOT_ERROR;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return DFOT_ERROR;
+    }
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return DFOT_ERROR;
+    }
+    file->data = (const uint8_t *)addr;
+    file->size = st.st_size;
+    return DFOT_OK;
+}
+
+void unmap_file(MappedFile *file)
+{
+    if (file->data != nullptr) {
+        munmap((void *)file->data, file->size);
+        file->data = nullptr;
+        file->size = 0;
+    }
+}
+
+// 文件标识：路径+inode+大小+修改时间的hash，文件被替换或修改后标识随之变化
+std::string get_file_identity(const std::string &path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return "";
+    }
+    std::string key = path + ":" + std::to_string(st.st_ino) + ":" +
+        std::to_string(st.st_size) + ":" + std::to_string(st.st_mtime);
+    char buffer[17] = {0};
+    snprintf(buffer, sizeof(buffer), "%016lx", (unsigned long)std::hash<std::string>{}(key));
+    return std::string(buffer);
+}
+
+// 在notes[0, size)中查找GNU build-id，note按4字节对齐
+static std::string find_build_id_note(const uint8_t *notes, size_t size)
+{
+    size_t pos = 0;
+    while (pos + sizeof(Elf64_Nhdr) <= size) {
+        const Elf64_Nhdr *nhdr = (const Elf64_Nhdr *)(notes + pos);
+        size_t name_pos = pos + sizeof(Elf64_Nhdr);
+        size_t desc_pos = name_pos + ((nhdr->n_namesz + 3) & ~3UL);
+        size_t next = desc_pos + ((nhdr->n_descsz + 3) & ~3UL);
+        if (desc_pos > size || desc_pos + nhdr->n_descsz > size) {
+            break;
+        }
+        if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == sizeof(ELF_NOTE_GNU) &&
+            memcmp(notes + name_pos, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU)) == 0 && nhdr->n_descsz > 0) {
+            static const char digits[] = "0123456789abcdef";
+            std::string build_id;
+            build_id.reserve(nhdr->n_descsz * 2);
+            for (size_t i = 0; i < nhdr->n_descsz; ++i) {
+                build_id.push_back(digits[notes[desc_pos + i] >> 4]);
+                build_id.push_back(digits[notes[desc_pos + i] & 0xf]);
+            }
+            return build_id;
+        }
+        pos = next;
+    }
+    return "";
+}
+
+std::string read_elf_build_id(const std::string &path)
+{
+    MappedFile elf{nullptr, 0};
+    if (map_file(path, &elf) != DFOT_OK) {
+        return "";
+    }
+    const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)elf.data;
+    if (elf.size < sizeof(Elf64_Ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr->e_ident[EI_CLASS] != ELFCLASS64) {
+        unmap_file(&elf);
+        return "";
+    }
+
+    // 优先通过程序头查找PT_NOTE段，通常位于文件起始处，只访问少量页面
+    std::string build_id;
+    if (ehdr->e_phentsize == sizeof(Elf64_Phdr) &&
+        ehdr->e_phoff + (uint64_t)ehdr->e_phnum * sizeof(Elf64_Phdr) <= elf.size) {
+        const Elf64_Phdr *phdrs = (const Elf64_Phdr *)(elf.data + ehdr->e_phoff);
+        for (uint16_t i = 0; i < ehdr->e_phnum && build_id == ""; ++i) {
+            if (phdrs[i].p_type == PT_NOTE && phdrs[i].p_offset + phdrs[i].p_filesz <= elf.size) {
+                build_id = find_build_id_note(elf.data + phdrs[i].p_offset, phdrs[i].p_filesz);
+            }
+        }
+    }
+    // 没有程序头的文件（如可重定位文件）查找SHT_NOTE节
+    if (build_id == "" && ehdr->e_shentsize == sizeof(Elf64_Shdr) &&
+        ehdr->e_shoff + (uint64_t)ehdr->e_shnum * sizeof(Elf64_Shdr) <= elf.size) {
+        const Elf64_Shdr *shdrs = (const Elf64_Shdr *)(elf.data + ehdr->e_shoff);
+        for (uint16_t i = 0; i < ehdr->e_shnum && build_id == ""; ++i) {
+            if (shdrs[i].sh_type == SHT_NOTE && shdrs[i].sh_offset + shdrs[i].sh_size <= elf.size) {
+                build_id = find_build_id_note(elf.data + shdrs[i].sh_offset, shdrs[i].sh_size);
+            }
+        }
+    }
+    unmap_file(&elf);
+    return build_id;
+}
+
+// 二进制标识：优先使用build-id，touch等不改变内容的操作不影响标识，原地升级后标识随之变化；
+// 没有build-id时退化为文件标识
+std::string get_bin_identity(const std::string &path)
+{
+    std::string build_id = read_elf_build_id(path);
+    if (build_id == "") {
+        return get_file_identity(path);
+    }
+    if (build_id.size() >= 16) {
+        return build_id.substr(0, 16);
+    }
+    char buffer[17] = {0};
+    snprintf(buffer, sizeof(buffer), "%016lx", (unsigned long)std::hash<std::string>{}(build_id));
+    return std::string(buffer);
+}
+
+typedef struct {
+    uint64_t addr;
+    uint64_t size;
+    const char *name;
+} RawSymbol;
+
+// 收集一个符号表section中的函数符号
+static void collect_func_symbols(const MappedFile &elf, const Elf64_Shdr *shdrs, uint16_t shnum,
+    const Elf64_Shdr &symtab, std::vector<RawSymbol> &symbols)
+{
+    if (symtab.sh_link >= shnum || symtab.sh_entsize != sizeof(Elf64_Sym) ||
+        symtab.sh_offset + symtab.sh_size > elf.size) {
+        return;
+    }
+    const Elf64_Shdr &strsec = shdrs[symtab.sh_link];
+    if (strsec.sh_offset + strsec.sh_size > elf.size) {
+        return;
+    }
+    const char *strtab = (const char *)(elf.data + strsec.sh_offset);
+    const Elf64_Sym *syms = (const Elf64_Sym *)(elf.data + symtab.sh_offset);
+    size_t num = symtab.sh_size / sizeof(Elf64_Sym);
+    for (size_t i = 0; i < num; ++i) {
+        const Elf64_Sym &sym = syms[i];
+        if (ELF64_ST_TYPE(sym.st_info) != STT_FUNC || sym.st_shndx == SHN_UNDEF ||
+            sym.st_value == 0 || sym.st_name >= strsec.sh_size) {
+            continue;
+        }
+        const char *name = strtab + sym.st_name;
+        if (memchr(name, '\0', strsec.sh_size - sym.st_name) == nullptr || name[0] == '\0') {
+            continue;
+        }
+        symbols.push_back(RawSymbol{sym.st_value, sym.st_size, name});
+    }
+}
+
+int build_symbol_index(const std::string &binary, const std::string &index_path)
+{
+    MappedFile elf{nullptr, 0};
+    if (map_file(binary, &elf) != DFOT_OK) {
+        ERROR("[run] map " << binary << " failed: " << strerror(errno));
+        return DFOT_ERROR;
+    }
+
+    const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)elf.data;
+    if (elf.size < sizeof(Elf64_Ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr->e_ident[EI_CLASS] != ELFCLASS64 || ehdr->e_shentsize != sizeof(Elf64_Shdr) ||
+        ehdr->e_shoff + (uint64_t)ehdr->e_shnum * sizeof(Elf64_Shdr) > elf.size) {
+        ERROR("[run] " << binary << " is not a valid ELF64 file");
+        unmap_file(&elf);
+        return DFOT_ERROR;
+    }
+
+    // 优先使用.symtab，.dynsym作为补充
+    const Elf64_Shdr *shdrs = (const Elf64_Shdr *)(elf.data + ehdr->e_shoff);
+    std::vector<RawSymbol> symbols;
+    for (uint32_t type : {SHT_SYMTAB, SHT_DYNSYM}) {
+        for (uint16_t i = 0; i < ehdr->e_shnum; ++i) {
+            if (shdrs[i].sh_type == type) {
+                collect_func_symbols(elf, shdrs, ehdr->e_shnum, shdrs[i], symbols);
+            }
+        }
+    }
+
+    // 按地址排序，同一地址保留最先出现（.symtab优先）的符号
+    std::stable_sort(symbols.begin(), symbols.end(),
+        [](const RawSymbol &a, const RawSymbol &b) { return a.addr < b.addr; });
+    symbols.erase(std::unique(symbols.begin(), symbols.end(),
+        [](const RawSymbol &a, const RawSymbol &b) { return a.addr == b.addr; }), symbols.end());
+
+    std::vector<SymbolEntry> entries;
+    std::string strtab;
+    entries.reserve(symbols.size());
+    for (const RawSymbol &sym : symbols) {
+        entries.push_back(SymbolEntry{sym.addr, sym.size, (uint32_t)strtab.size(), 0});
+        strtab.append(sym.name);
+        strtab.push_back('\0');
+    }
+    unmap_file(&elf);
+
+    // 先写临时文件再重命名，避免并发读取到不完整的索引
+    SymbolIndexHeader header;
+    memcpy(header.magic, SYMBOL_INDEX_MAGIC, sizeof(header.magic));
+    header.count = entries.size();
+    header.strtab_size = strtab.size();
+    std::string tmp_path = index_path + ".tmp";
+    FILE *fp = fopen(tmp_path.c_str(), "wb");
+    if (fp == nullptr) {
+        ERROR("[run] fopen " << tmp_path << " error");
+        return DFOT_ERROR;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+        (entries.empty() || fwrite(entries.data(), sizeof(SymbolEntry), entries.size(), fp) == entries.size()) &&
+        (strtab.empty() || fwrite(strtab.data(), 1, strtab.size(), fp) == strtab.size());
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp_path.c_str(), index_path.c_str()) != 0) {
+        ERROR("[run] write symbol index " << index_path << " error");
+        std::remove(tmp_path.c_str());
+        return DFOT_ERROR;
+    }
+
+    INFO("[run] built symbol index for " << binary << ": " << entries.size() << " functions");
+    return DFOT_OK;
+}
+
+SymbolIndex::~SymbolIndex()
+{
+    unload();
+}
+
+void SymbolIndex::unload()
+{
+    if (map != nullptr) {
+        munmap(map, map_size);
+    }
+    map = nullptr;
+    map_size = 0;
+    entries = nullptr;
+    count = 0;
+    strtab = nullptr;
+    strtab_size = 0;
+    bin_identity = "";
+}
+
+int SymbolIndex::map_index(const std::string &path)
+{
+    MappedFile file{nullptr, 0};
+    if (map_file(path, &file) != DFOT_OK) {
+        return DFOT_ERROR;
+    }
+    const SymbolIndexHeader *header = (const SymbolIndexHeader *)file.data;
+    if (file.size < sizeof(SymbolIndexHeader) ||
+        memcmp(header->magic, SYMBOL_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+        sizeof(SymbolIndexHeader) + header->count * sizeof(SymbolEntry) + header->strtab_size != file.size) {
+        unmap_file(&file);
+        return DFOT_ERROR;
+    }
+    map = (void *)file.data;
+    map_size = file.size;
+    entries = (const SymbolEntry *)(file.data + sizeof(SymbolIndexHeader));
+    count = header->count;
+    strtab = (const char *)(entries + count);
+    strtab_size = header->strtab_size;
+    return DFOT_OK;
+}
+
+// 二进制完整路径的16位hash，区分不同目录下的同名二进制
+static std::string get_path_hash(const std::string &path)
+{
+    char buffer[17] = {0};
+    snprintf(buffer, sizeof(buffer), "%016lx", (unsigned long)std::hash<std::string>{}(path));
+    return std::string(buffer);
+}
+
+// 删除同一路径二进制旧版本的索引，文件名格式：<binary>_<路径hash>_<文件标识>.symidx
+static void remove_stale_indexes(const std::string &binary, const std::string &cache_dir,
+    const std::string &current)
+{
+    std::string name_prefix = boost::filesystem::path(binary).filename().string() + "_";
+    std::string prefix = name_prefix + get_path_hash(binary) + "_";
+    boost::system::error_code ec;
+    for (boost::filesystem::directory_iterator it(cache_dir, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (it->path().extension() != ".symidx" || it->path().string() == current) {
+            continue;
+        }
+        // 同时清理不含路径hash的旧格式索引：<binary>_<文件标识>.symidx
+        bool stale = (name.size() == prefix.size() + 16 + strlen(".symidx") &&
+            name.compare(0, prefix.size(), prefix) == 0) ||
+            (name.size() == name_prefix.size() + 16 + strlen(".symidx") &&
+            name.compare(0, name_prefix.size(), name_prefix) == 0);
+        if (stale) {
+            boost::filesystem::remove(it->path(), ec);
+        }
+    }
+}
+
+int SymbolIndex::load(const std::string &binary, const std::string &cache_dir)
+{
+    // BOLT优化会保留build-id，同一路径的.rto重新优化后build-id不变，索引缓存按文件标识区分
+    std::string identity = get_file_identity(binary);
+    if (identity == "") {
+        ERROR("[run] get identity of " << binary << " failed");
+        return DFOT_ERROR;
+    }
+    if (loaded() && identity == bin_identity) {
+        return DFOT_OK;
+    }
+    unload();
+
+    // 索引缓存以二进制文件名、路径hash和文件标识（inode、大小、修改时间）命名，插件重启后可直接复用
+    std::string index_path = cache_dir + "/" + boost::filesystem::path(binary).filename().string() + "_" +
+        get_path_hash(binary) + "_" + identity + ".symidx";
+    if (map_index(index_path) != DFOT_OK) {
+        if (build_symbol_index(binary, index_path) != DFOT_OK || map_index(index_path) != DFOT_OK) {
+            ERROR("[run] load symbol index for " << binary << " failed");
+            return DFOT_ERROR;
+        }
+        remove_stale_indexes(binary, cache_dir, index_path);
+    }
+    bin_identity = identity;
+    return DFOT_OK;
+}
+
+const char *SymbolIndex::lookup(uint64_t addr, uint64_t *offset) const
+{
+    if (count == 0) {
+        return nullptr;
+    }
+    // 找到最后一个起始地址不大于addr的函数
+    const SymbolEntry *end = entries + count;
+    const SymbolEntry *it = std::upper_bound(entries, end, addr,
+        [](uint64_t value, const SymbolEntry &entry) { return value < entry.addr; });
+    if (it == entries) {
+        return nullptr;
+    }
+    --it;
+    if (it->size != 0 && addr >= it->addr + it->size) {
+        return nullptr;
+    }
+    if (it->name >= strtab_size) {
+        return nullptr;
+    }
+    *offset = addr - it->addr;
+    return strtab + it->name;
+}
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include "logs.h"
+#include "utils.h"
+#include "opt.h"
+#include "profile_store.h"
+#include "executor.h"
+
+OptimizeExecutor optimize_executor;
+
+static const char *job_state_name(JOB_STATE state)
+{
+    switch (state) {
+        case JOB_QUEUED:
+            return "queued";
+        case JOB_RUNNING:
+            return "running";
+        case JOB_DONE:
+            return "done";
+        case JOB_FAILED:
+            return "failed";
+        case JOB_CANCELLED:
+            return "cancelled";
+    }
+    return "unknown";
+}
+
+static const char *job_type_name(JOB_TYPE type)
+{
+    return type == JOB_ROLLBACK ? "rollback" : "optimize";
+}
+
+void OptimizeExecutor::start(int concurrency)
+{
+    stop();
+    stopping = false;
+    cancelling = false;
+    for (int i = 0; i < concurrency; ++i) {
+        workers.emplace_back(&OptimizeExecutor::worker_loop, this);
+    }
+    INFO("[enable] optimize executor started, concurrency: " << concurrency);
+}
+
+void OptimizeExecutor::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+        cancelling = true;
+        while (!queue.empty()) {
+            finish(queue.front(), JOB_CANCELLED);
+            queue.pop_front();
+        }
+        if (!running.empty()) {
+            INFO("[disable] cancelling " << running.size() << " running optimize jobs");
+        }
+    }
+    cv.notify_all();
+    for (auto &worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+    // 任务记录引用的AppConfig在去使能后被释放，不能保留到下次使能
+    std::lock_guard<std::mutex> lock(mtx);
+    history.clear();
+}
+
+// 通过硬链接保存文件快照，原文件被重新导出（rename替换）时快照内容不变，链接失败时复制
+static bool snapshot_file(const std::string &path, const std::string &snapshot)
+{
+    if (link(path.c_str(), snapshot.c_str()) == 0) {
+        return true;
+    }
+    boost::system::error_code ec;
+    boost::filesystem::copy_file(path, snapshot, boost::filesystem::copy_options::overwrite_existing, ec);
+    if (ec) {
+        ERROR("[run] snapshot " << path << " failed: " << ec.message());
+        return false;
+    }
+    return true;
+}
+
+bool OptimizeExecutor::submit(AppConfig *app, const std::string &profile)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (stopping || workers.empty()) {
+        return false;
+    }
+
+    // 保存profile快照，保存的profile版本在执行时生成BOLT profile和热点函数列表，
+    // 预置profile附带的热点函数列表一并保存
+    uint64_t id = next_id++;
+    std::string snapshot = profile + ".job" + std::to_string(id);
+    if (!snapshot_file(profile, snapshot)) {
+        return false;
+    }
+    std::string suffix = PROFILE_STORE_SUFFIX;
+    bool stored = profile.size() > suffix.size() &&
+        profile.compare(profile.size() - suffix.size(), suffix.size(), suffix) == 0;
+    std::string funcs_file = profile + HOT_FUNCS_SUFFIX;
+    if (!stored && access(funcs_file.c_str(), F_OK) == 0) {
+        snapshot_file(funcs_file, snapshot + HOT_FUNCS_SUFFIX);
+    }
+
+    auto job = std::make_shared<OptimizeJob>(
+        OptimizeJob{id, app, JOB_OPTIMIZE, snapshot, stored, JOB_QUEUED, get_current_timestamp(), 0, 0});
+    queue.push_back(job);
+    INFO("[run] optimize job " << id << " for [" << app->app_name << "] queued");
+    cv.notify_one();
+    return true;
+}
+
+bool OptimizeExecutor::submit_rollback(AppConfig *app)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    // 排队或运行中的优化任务会替换当前优化版本，无需再回退
+    if (stopping || workers.empty() || busy_locked(app)) {
+        return false;
+    }
+    uint64_t id = next_id++;
+    auto job = std::make_shared<OptimizeJob>(
+        OptimizeJob{id, app, JOB_ROLLBACK, "", false, JOB_QUEUED, get_current_timestamp(), 0, 0});
+    queue.push_back(job);
+    INFO("[run] rollback job " << id << " for [" << app->app_name << "] queued");
+    cv.notify_one();
+    return true;
+}
+
+bool OptimizeExecutor::busy(AppConfig *app)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return busy_locked(app);
+}
+
+// 调用方持有mtx
+bool OptimizeExecutor::busy_locked(AppConfig *app)
+{
+    auto match = [app](const std::shared_ptr<OptimizeJob> &job) { return job->app == app; };
+    return std::any_of(queue.begin(), queue.end(), match) ||
+        std::any_of(running.begin(), running.end(), match);
+}
+
+// 调用方持有mtx
+void OptimizeExecutor::finish(const std::shared_ptr<OptimizeJob> &job, JOB_STATE state)
+{
+    job->state = state;
+    job->end_ts = get_current_timestamp();
+    if (job->type == JOB_OPTIMIZE) {
+        std::string profile = job->stored ? job->profile + PROFILE_FDATA_SUFFIX : job->profile;
+        std::remove(job->profile.c_str());
+        std::remove(profile.c_str());
+        std::remove((profile + HOT_FUNCS_SUFFIX).c_str());
+    }
+    history.push_back(job);
+    if (history.size() > OPTIMIZE_JOB_HISTORY) {
+        history.pop_front();
+    }
+    INFO("[run] " << job_type_name(job->type) << " job " << job->id << " for [" << job->app->app_name << "] "
+        << job_state_name(state)
+        << ", wait: " << (job->start_ts > 0 ? job->start_ts - job->submit_ts : job->end_ts - job->submit_ts)
+        << "ms, run: " << (job->start_ts > 0 ? job->end_ts - job->start_ts : 0) << "ms");
+}
+
+// 保存的profile版本在执行时转换为BOLT profile和热点函数列表，预置profile直接使用
+static bool run_optimize(const OptimizeJob &job)
+{
+    if (!job.stored) {
+        return do_optimize(job.app, job.profile);
+    }
+    std::string fdata = job.profile + PROFILE_FDATA_SUFFIX;
+    if (profile_store_export(job.profile, fdata, job.app->hot_coverage / 100) != DFOT_OK) {
+        ERROR("[run] convert profile " << job.profile << " for [" << job.app->app_name << "] failed");
+        return false;
+    }
+    return do_optimize(job.app, fdata);
+}
+
+void OptimizeExecutor::worker_loop()
+{
+    while (true) {
+        std::shared_ptr<OptimizeJob> job;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = queue.front();
+            queue.pop_front();
+            job->state = JOB_RUNNING;
+            job->start_ts = get_current_timestamp();
+            running.push_back(job);
+        }
+
+        bool ok = job->type == JOB_ROLLBACK ? rollback_app_optimization(job->app) :
+            run_optimize(*job);
+
+        std::lock_guard<std::mutex> lock(mtx);
+        running.erase(std::find(running.begin(), running.end(), job));
+        finish(job, ok ? JOB_DONE : (cancelling ? JOB_CANCELLED : JOB_FAILED));
+    }
+}
+
+void OptimizeExecutor::debug_print()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    DEBUG("[DFOT_EXECUTOR] workers: " << workers.size() << ", queued: " << queue.size()
+        << ", running: " << running.size());
+    for (const auto &jobs : {std::vector<std::shared_ptr<OptimizeJob>>(queue.begin(), queue.end()),
+        running, std::vector<std::shared_ptr<OptimizeJob>>(history.begin(), history.end())}) {
+        for (const auto &job : jobs) {
+            DEBUG("[DFOT_EXECUTOR] " << job_type_name(job->type) << " job " << job->id << " ["
+                << job->app->app_name << "] "
+                << job_state_name(job->state) << ", submit: " << turn_timestamp_to_format_time(job->submit_ts));
+        }
+    }
+}
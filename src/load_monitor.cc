@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include "logs.h"
+#include "load_monitor.h"
+
+LoadMonitor load_monitor;
+
+void LoadMonitor::init(const LoadPolicy &load_policy)
+{
+    policy = load_policy;
+    metrics = LoadMetrics{};
+    last_busy = 0;
+    last_total = 0;
+    idle = false;
+    idle_since = 0;
+}
+
+// 解析/proc/stat首行："cpu user nice system idle iowait irq softirq steal ..."
+bool LoadMonitor::read_cpu_usage()
+{
+    FILE *fp = fopen(PROC_STAT_PATH, "r");
+    if (fp == nullptr) {
+        return false;
+    }
+    unsigned long long user = 0, nice = 0, system = 0, idle_time = 0;
+    unsigned long long iowait = 0, irq = 0, softirq = 0, steal = 0;
+    int n = fscanf(fp, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+        &user, &nice, &system, &idle_time, &iowait, &irq, &softirq, &steal);
+    fclose(fp);
+    if (n < 4) {
+        return false;
+    }
+    uint64_t busy = user + nice + system + irq + softirq + steal;
+    uint64_t total = busy + idle_time + iowait;
+    bool valid = last_total != 0 && total > last_total;
+    if (valid) {
+        metrics.cpu_usage = 100.0 * (busy - last_busy) / (total - last_total);
+    }
+    last_busy = busy;
+    last_total = total;
+    return valid;
+}
+
+static double read_loadavg()
+{
+    FILE *fp = fopen(PROC_LOADAVG_PATH, "r");
+    if (fp == nullptr) {
+        return 0;
+    }
+    double load1 = 0;
+    if (fscanf(fp, "%lf", &load1) != 1) {
+        load1 = 0;
+    }
+    fclose(fp);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? 100.0 * load1 / cpus : 0;
+}
+
+// 解析PSI首行："some avg10=0.00 avg60=0.00 avg300=0.00 total=0"
+static double read_psi(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == nullptr) {
+        return 0;
+    }
+    double avg10 = 0;
+    if (fscanf(fp, "some avg10=%lf", &avg10) != 1) {
+        avg10 = 0;
+    }
+    fclose(fp);
+    return avg10;
+}
+
+void LoadMonitor::sample(int64_t now)
+{
+    if (!read_cpu_usage()) {
+        return;
+    }
+    metrics.load = read_loadavg();
+    metrics.psi_cpu = read_psi(PSI_CPU_PATH);
+    metrics.psi_memory = read_psi(PSI_MEMORY_PATH);
+
+    // 迟滞判断：空闲状态下放宽阈值，非空闲状态下需所有指标都低于阈值才进入空闲
+    double margin = idle ? policy.hysteresis : 0;
+    bool quiet = metrics.cpu_usage < policy.threshold + margin &&
+        metrics.load < policy.threshold + margin &&
+        metrics.psi_cpu < policy.psi_threshold + margin &&
+        metrics.psi_memory < policy.psi_threshold + margin;
+    if (quiet == idle) {
+        return;
+    }
+    idle = quiet;
+    idle_since = now;
+    INFO("[run] host load changed to " << (idle ? "idle" : "busy")
+        << ", cpu: " << metrics.cpu_usage << "%, load: " << metrics.load
+        << "%, psi cpu: " << metrics.psi_cpu << "%, psi memory: " << metrics.psi_memory << "%");
+}
+
+void LoadMonitor::debug_print(int64_t now) const
+{
+    DEBUG("[DFOT_LOAD] cpu: " << metrics.cpu_usage << "%, load: " << metrics.load
+        << "%, psi cpu: " << metrics.psi_cpu << "%, psi memory: " << metrics.psi_memory
+        << "%, verdict: " << (low_load(now) ? "low load" : (idle ? "idle (quiet window)" : "busy")));
+}
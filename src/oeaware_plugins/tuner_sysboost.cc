@@ -1,6 +1,3 @@
-#include <cstring>
-#include <securec.h>
-
 #include <oeaware/interface.h>
 #include <oeaware/data_list.h>
 #include <oeaware/data/pmu_sampling_data.h>
@@ -11,6 +8,9 @@
 #include "records.h"
 
 #include "opt.h"
+#include "checkpoint.h"
+#include "executor.h"
+#include "process_tracker.h"
 #include "tuner.h"
 
 // 当前优化插件需要的采样数据来源于oeaware-manager采样实例pmu_sampling_collector
@@ -34,18 +34,11 @@ SysboostTuner::SysboostTuner()
 
     depTopic.instanceName = DEP_INSTANCE_NAME;
     depTopic.topicName = DEP_TOPIC_NAME;
-
-    processingArea = nullptr;
-    processingAreaSize = 0;
 }
 
 SysboostTuner::~SysboostTuner()
 {
-    if (processingArea != nullptr) {
-        free(processingArea);
-        processingArea = nullptr;
-        processingAreaSize = 0;
-    }
+    pipeline.stop();
 }
 
 /// @brief 调优插件不需要打开topic
@@ -73,48 +66,8 @@ void SysboostTuner::UpdateData(const DataList &dataList)
         return;
     }
 
-    static bool processing = false;
-    if (processing) {
-        DEBUG("[update] last processing is not finished, skip");
-        return;
-    }
-    processing = true;
-    
-    int64_t start_ts = get_current_timestamp();
-    records.modules.clear();
-    uint64_t total_samples = 0;
-    for (unsigned long long i = 0; i < dataList.len; i++) {
-        PmuSamplingData *data = (PmuSamplingData *)(dataList.data[i]);
-
-        // 复制一份采样数据到插件公共内存中，防止数据被覆盖，
-        // 如果内存不足，则重新申请内存
-        if (processingArea == nullptr ||
-            processingAreaSize < sizeof(PmuData) * data->len) {
-            if (processingArea != nullptr) {
-                free(processingArea);
-            }
-            processingArea = malloc(sizeof(PmuData) * data->len);
-            if (processingArea == nullptr) {
-                processingAreaSize = 0;
-                continue;
-            }
-            processingAreaSize = sizeof(PmuData) * data->len;
-        }
-        auto ret = memcpy_s(
-            processingArea, processingAreaSize, data->pmuData, sizeof(PmuData) * data->len);
-        if (ret != EOK) {
-            continue;
-        }
-        process_pmudata((PmuData *)processingArea, data->len);
-        total_samples += data->len;
-    }
-    records.processed_samples += total_samples;
-
-    int64_t end_ts = get_current_timestamp();
-    DEBUG("[update] processing pmudata cost: " << (end_ts - start_ts) << " ms, "
-        << "current: " << total_samples << " samples, "
-        << "total: " << records.processed_samples << " samples");
-    processing = false;
+    // 仅入队，由聚合线程异步处理，避免阻塞oeAware回调线程
+    pipeline.submit(dataList);
 }
 
 /// @brief 使能调优插件实例
@@ -132,23 +85,53 @@ oeaware::Result SysboostTuner::Enable(const std::string &param)
         return oeaware::Result(FAILED);
     }
 
+    // 使能失败时oeAware不会调用Disable，各失败分支需自行清理，下次使能重新读取配置
     if (!check_configs_valid()) {
         ERROR("[enable] invalid configs");
+        cleanup_configs();
         return oeaware::Result(FAILED);
     }
 
     if (!check_dependence_ready()) {
         ERROR("[enable] dependencies are not ready");
+        cleanup_configs();
         return oeaware::Result(FAILED);
     }
 
     reset_records();
 
-    if (Subscribe(depTopic).code != OK) {
-        ERROR("[enable] subscribe dep topic error");
+    optimize_executor.start(configs->tuner_optimizing_jobs);
+    load_monitor.init(configs->tuner_low_load);
+    process_tracker.start();
+
+    // 恢复上次停止前未导出的采样数据
+    if (configs->collector_checkpoint_period > 0) {
+        for (AppConfig *app : configs->apps) {
+            restore_app_profile(app);
+        }
+    }
+
+    if (!pipeline.start(configs->collector_queue_size, configs->collector_queue_block_time)) {
+        ERROR("[enable] start aggregation worker failed");
+        StopWorkers();
+        cleanup_configs();
         return oeaware::Result(FAILED);
     }
 
+    // 采样策略1在应用负载达到阈值时才订阅采样数据
+    if (configs->sampling_strategy == 0) {
+        if (Subscribe(depTopic).code != OK) {
+            ERROR("[enable] subscribe dep topic error");
+            StopWorkers();
+            cleanup_configs();
+            return oeaware::Result(FAILED);
+        }
+        subscribed = true;
+    } else {
+        lastLoadCheck = 0;
+        INFO("[enable] sampling starts when app cpu usage exceeds " << configs->high_load_threshold << "%");
+    }
+
     INFO("[enable] plugin instance [" << TUNER_INSTANCE_NAME << "] enabled");
 	return oeaware::Result(OK);
 }
@@ -156,16 +139,27 @@ oeaware::Result SysboostTuner::Enable(const std::string &param)
 /// @brief 禁用调优插件实例
 void SysboostTuner::Disable()
 {
-    if (Unsubscribe(depTopic).code != OK) {
+    // 先停止聚合线程和优化任务，再退订并清理其依赖的配置数据，停止后到达的采样数据直接丢弃
+    StopWorkers();
+    if (subscribed && Unsubscribe(depTopic).code != OK) {
         ERROR("[disable] unsubscribe dep topic error");
     }
+    subscribed = false;
+
+    // 保存未导出的采样数据，下次使能时恢复
+    if (configs->collector_checkpoint_period > 0) {
+        for (AppConfig *app : configs->apps) {
+            std::lock_guard<std::mutex> lock(app->profile_mtx);
+            checkpoint_app_profile(app);
+        }
+    }
 
     for (auto it = configs->apps.begin(); it != configs->apps.end(); ++it) {
         AppConfig *app = *it;
         if (app->status != OPTIMIZED) {
             continue;
         }
-        auto result = exec_cmd("sysboostd --stop=" + app->full_path);
+        auto result = exec_cmd({"sysboostd", "--stop=" + app->full_path});
         if (result.ret != 0) {
             ERROR("[disable] cleanup last optimization for [" << app->app_name << "] failed!");
         }
@@ -175,43 +169,92 @@ void SysboostTuner::Disable()
     INFO("[disable] instance [" << TUNER_INSTANCE_NAME << "] disabled");
 }
 
+// 停止使能时启动的聚合线程、优化任务线程和进程跟踪线程，未启动的部分直接跳过
+void SysboostTuner::StopWorkers()
+{
+    pipeline.stop();
+    optimize_executor.stop();
+    process_tracker.stop();
+}
+
+// 采样策略1：应用负载超过阈值时订阅采样数据，低于阈值减迟滞值时退订，只采集高负载场景的profile
+void SysboostTuner::UpdateSampling()
+{
+    int64_t now = get_current_timestamp();
+    if (now - lastLoadCheck < configs->high_load_check_period) {
+        return;
+    }
+    lastLoadCheck = now;
+
+    bool high_load = update_app_cpu_usage(subscribed);
+    if (high_load && !subscribed) {
+        if (Subscribe(depTopic).code != OK) {
+            ERROR("[run] subscribe dep topic error");
+            return;
+        }
+        subscribed = true;
+        INFO("[run] app load exceeds threshold, start sampling");
+    } else if (!high_load && subscribed) {
+        // 队列中的采样已按值复制，不引用libkperf的符号缓存，退订时无需等待聚合线程
+        if (Unsubscribe(depTopic).code != OK) {
+            ERROR("[run] unsubscribe dep topic error");
+            return;
+        }
+        subscribed = false;
+        INFO("[run] app load falls below threshold, stop sampling");
+    }
+}
+
 /// @brief 调优插件主逻辑
 void SysboostTuner::Run()
 {
     // 1. 检查优化条件
-    // 2. 获取profile，实施优化
-    static bool optimizing = false;
-
+    // 2. 获取profile，提交优化任务，优化在任务线程中执行，Run()不阻塞
     if (configs == nullptr) {
         FATAL("[run] no valid configs found");
         return;
     }
 
-    // 防止第一轮优化还未结束就触发新一轮优化
-    if (optimizing) {
-        DEBUG("[run] last optimizing is not finished, skip");
-        return;
+    // 低负载条件依赖持续的负载采样
+    if (configs->tuner_optimizing_condition != 0) {
+        load_monitor.sample(get_current_timestamp());
+    }
+    if (configs->sampling_strategy == 1) {
+        UpdateSampling();
     }
 
-    optimizing = true;
+    // 验证已生效的优化版本，性能下降时回退
+    if (configs->tuner_validation_threshold > 0) {
+        int64_t now = get_current_timestamp();
+        for (AppConfig *app : configs->apps) {
+            validate_app_performance(app, now);
+        }
+    }
 
     for (auto it = configs->apps.begin(); it != configs->apps.end(); ++it) {
         AppConfig *app = *it;
+        // 无锁预检查，只有待优化应用才需要加锁，大量应用时每个周期开销很小
+        if (app->status != NEED_OPTIMIZED) {
+            continue;
+        }
+        // 防止上一次优化还未结束就触发新一轮优化
+        if (optimize_executor.busy(app)) {
+            continue;
+        }
+        // 应用状态和实例信息会被聚合线程修改，需要持锁访问
+        std::lock_guard<std::mutex> lock(app->profile_mtx);
         // step2: 检查应用是否满足优化条件
         if (!is_app_eligible_for_optimization(app)) {
             continue;
         }
 
         // step3: 获取profile文件并优化
-        std::lock_guard<std::mutex> lock(app->profile_mtx);
         std::string profile = get_app_profile(app);
         if (profile == "") {
             // 无法匹配profile文件时，需要回退app的NEED_OPTIMIZED状态，避免重复判断和日志打印
             app->status = (app->instances.size() > 1) ? OPTIMIZED : UNOPTIMIZED;
             continue;
         }
-        do_optimize(app, profile);
+        optimize_executor.submit(app, profile);
     }
-
-    optimizing = false;
 }
@@ -0,0 +1,253 @@
+#include <chrono>
+#include <cstring>
+
+#include <libkperf/pmu.h>
+#include <oeaware/data/pmu_sampling_data.h>
+
+#include "logs.h"
+#include "utils.h"
+#include "configs.h"
+#include "records.h"
+#include "opt.h"
+#include "aggregator.h"
+#include "pipeline.h"
+
+void SampleRing::init(size_t capacity)
+{
+    // 预留一个空槽位区分队列满和队列空
+    slots.clear();
+    slots.resize(capacity + 1);
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+}
+
+SampleBatch *SampleRing::acquire_write()
+{
+    size_t t = tail.load(std::memory_order_relaxed);
+    if ((t + 1) % slots.size() == head.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return &slots[t];
+}
+
+void SampleRing::commit_write()
+{
+    size_t t = tail.load(std::memory_order_relaxed);
+    tail.store((t + 1) % slots.size(), std::memory_order_release);
+}
+
+SampleBatch *SampleRing::acquire_read()
+{
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return &slots[h];
+}
+
+void SampleRing::commit_read()
+{
+    size_t h = head.load(std::memory_order_relaxed);
+    head.store((h + 1) % slots.size(), std::memory_order_release);
+}
+
+size_t SampleRing::depth() const
+{
+    size_t h = head.load(std::memory_order_acquire);
+    size_t t = tail.load(std::memory_order_acquire);
+    return (t + slots.size() - h) % slots.size();
+}
+
+bool AggregationPipeline::start(size_t queue_size, int block_time)
+{
+    if (running) {
+        return true;
+    }
+    ring.init(queue_size);
+    this->block_time = block_time;
+    sharded_aggregator.start(configs->collector_aggregation_threads);
+    running = true;
+    worker = std::thread(&AggregationPipeline::worker_loop, this);
+    INFO("[enable] aggregation worker started, queue size: " << queue_size
+        << ", aggregation threads: " << configs->collector_aggregation_threads);
+    return true;
+}
+
+void AggregationPipeline::stop()
+{
+    if (!running) {
+        return;
+    }
+    running = false;
+    wait_cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    sharded_aggregator.stop();
+    // 未处理的批次直接丢弃，配置即将被清理
+    while (ring.acquire_read() != nullptr) {
+        ring.commit_read();
+    }
+    records.queue_depth = 0;
+    INFO("[disable] aggregation worker stopped");
+}
+
+static void clear_batch(SampleBatch *batch)
+{
+    batch->samples.clear();
+    batch->procs.clear();
+    batch->symbols.clear();
+    batch->modules.clear();
+    batch->strings.clear();
+    batch->proc_index.clear_keep_capacity();
+    batch->symbol_index.clear_keep_capacity();
+    batch->module_index.clear_keep_capacity();
+}
+
+static uint32_t add_string(SampleBatch *batch, const char *str)
+{
+    if (str == nullptr) {
+        return SAMPLE_NO_STRING;
+    }
+    uint32_t offset = (uint32_t)batch->strings.size();
+    batch->strings.insert(batch->strings.end(), str, str + strlen(str) + 1);
+    return offset;
+}
+
+static uint32_t add_proc(SampleBatch *batch, const PmuData &pmu)
+{
+    bool inserted = false;
+    uint32_t &index = batch->proc_index.get_or_insert((uint64_t)pmu.pid, &inserted);
+    if (!inserted) {
+        return index;
+    }
+    index = (uint32_t)batch->procs.size();
+    SampleProc &proc = batch->procs.emplace_back();
+    proc.pid = pmu.pid;
+    proc.ts = pmu.ts;
+    if (pmu.comm != nullptr) {
+        strncpy(proc.comm, pmu.comm, SAMPLE_COMM_LEN - 1);
+        proc.comm[SAMPLE_COMM_LEN - 1] = '\0';
+    } else {
+        proc.comm[0] = '\0';
+    }
+    return index;
+}
+
+// 模块按路径内容去重，一个批次通常只涉及少量模块
+static uint32_t add_module(SampleBatch *batch, const char *module)
+{
+    if (module == nullptr) {
+        module = "";
+    }
+    bool inserted = false;
+    uint32_t &index = batch->module_index.get_or_insert(hash_module_path(module), &inserted);
+    if (!inserted && strcmp(sample_string(*batch, batch->modules[index]), module) == 0) {
+        return index;
+    }
+    // hash冲突时不建立索引，直接追加
+    uint32_t added = (uint32_t)batch->modules.size();
+    if (inserted) {
+        index = added;
+    }
+    batch->modules.push_back(add_string(batch, module));
+    return added;
+}
+
+// 同一pid同一地址的采样复用libkperf的同一个symbol，按指针去重后只复制一次
+static uint32_t add_symbol(SampleBatch *batch, const struct Symbol *symbol)
+{
+    bool inserted = false;
+    uint32_t &index = batch->symbol_index.get_or_insert((uint64_t)symbol, &inserted);
+    if (!inserted) {
+        return index;
+    }
+    uint32_t added = (uint32_t)batch->symbols.size();
+    index = added;
+    uint32_t module = add_module(batch, symbol->module);
+    uint32_t name = add_string(batch, symbol->mangleName);
+    batch->symbols.push_back(SampleSymbol{symbol->codeMapAddr, symbol->offset, module, name});
+    return added;
+}
+
+bool AggregationPipeline::submit(const DataList &dataList)
+{
+    uint64_t total_samples = 0;
+    for (unsigned long long i = 0; i < dataList.len; i++) {
+        total_samples += ((PmuSamplingData *)(dataList.data[i]))->len;
+    }
+    if (!running || total_samples == 0) {
+        return false;
+    }
+
+    SampleBatch *batch = ring.acquire_write();
+    // 队列满时在block_time内等待聚合线程腾出槽位，形成反压
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(block_time);
+    while (batch == nullptr && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        batch = ring.acquire_write();
+    }
+    if (batch == nullptr) {
+        uint64_t dropped = ++records.dropped_batches;
+        records.dropped_samples += total_samples;
+        // 避免日志刷屏，仅在首次及每100次丢弃时打印
+        if (dropped == 1 || dropped % 100 == 0) {
+            WARN("[update] sample queue is full, dropped batches: " << dropped
+                << ", dropped samples: " << records.dropped_samples);
+        }
+        return false;
+    }
+
+    // 原地读取采样数据，仅提取聚合需要的字段，并提前过滤无效数据和内核地址
+    // 槽位vector的容量会被保留，稳定运行后不再申请内存
+    clear_batch(batch);
+    batch->samples.reserve(total_samples);
+    for (unsigned long long i = 0; i < dataList.len; i++) {
+        PmuSamplingData *data = (PmuSamplingData *)(dataList.data[i]);
+        for (int j = 0; j < data->len; j++) {
+            const PmuData &pmu = data->pmuData[j];
+            if (pmu.stack == nullptr || pmu.stack->symbol == nullptr ||
+                pmu.stack->symbol->addr >= 0xffff000000000000) {
+                continue;
+            }
+            batch->samples.push_back(SampleRecord{pmu.ts, add_proc(batch, pmu), add_symbol(batch, pmu.stack->symbol)});
+        }
+    }
+    ring.commit_write();
+
+    uint64_t depth = ring.depth();
+    records.queued_batches++;
+    records.queue_depth = depth;
+    if (depth > records.queue_depth_max) {
+        records.queue_depth_max = depth;
+    }
+    wait_cv.notify_one();
+    return true;
+}
+
+void AggregationPipeline::worker_loop()
+{
+    while (running) {
+        SampleBatch *batch = ring.acquire_read();
+        if (batch == nullptr) {
+            // 超时等待，防止错过无锁通知导致的唤醒丢失
+            std::unique_lock<std::mutex> lock(wait_mtx);
+            wait_cv.wait_for(lock, std::chrono::milliseconds(100));
+            continue;
+        }
+
+        int64_t start_ts = get_current_timestamp();
+        uint64_t total_samples = batch->samples.size();
+        process_pmudata(*batch);
+        ring.commit_read();
+        records.processed_samples += total_samples;
+        records.queue_depth = ring.depth();
+
+        int64_t end_ts = get_current_timestamp();
+        DEBUG("[update] processing pmudata cost: " << (end_ts - start_ts) << " ms, "
+            << "current: " << total_samples << " samples, "
+            << "total: " << records.processed_samples << " samples, "
+            << "queue depth: " << records.queue_depth << "/" << ring.capacity() << ", "
+            << "dropped batches: " << records.dropped_batches);
+    }
+}
@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "logs.h"
+#include "utils.h"
+#include "process_runner.h"
+
+extern char **environ;
+
+// 子进程退出后继续读取残留输出的时长，后台化的后代进程可能一直持有管道，单位ms
+#define EXEC_DRAIN_TIME 100
+// 等待子进程退出时的轮询间隔，单位ms
+#define EXEC_POLL_INTERVAL 50
+
+std::string format_cmd(const std::vector<std::string> &argv)
+{
+    std::string cmd;
+    for (const std::string &arg : argv) {
+        if (!cmd.empty()) {
+            cmd += ' ';
+        }
+        if (arg.find_first_of(" \t\"") == std::string::npos) {
+            cmd += arg;
+        } else {
+            cmd += '"' + arg + '"';
+        }
+    }
+    return cmd;
+}
+
+// 解析"0-3,8"格式的CPU列表
+static bool parse_cpu_list(const std::string &cpus, cpu_set_t *set)
+{
+    CPU_ZERO(set);
+    size_t pos = 0;
+    while (pos < cpus.size()) {
+        size_t end = cpus.find(',', pos);
+        std::string item = cpus.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        pos = end == std::string::npos ? cpus.size() : end + 1;
+        if (item.empty()) {
+            continue;
+        }
+        char *next = nullptr;
+        long first = strtol(item.c_str(), &next, 10);
+        long last = *next == '-' ? strtol(next + 1, &next, 10) : first;
+        if (*next != '\0' || first < 0 || last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            CPU_SET(cpu, set);
+        }
+    }
+    return CPU_COUNT(set) > 0;
+}
+
+// 子进程exec前的设置步骤，失败时通过错误管道上报
+enum SPAWN_STAGE {
+    SPAWN_CGROUP,
+    SPAWN_NICE,
+    SPAWN_CPUS,
+    SPAWN_RLIMIT,
+    SPAWN_EXEC
+};
+
+typedef struct {
+    int stage;
+    int arg; // SPAWN_RLIMIT时为资源类型
+    int err;
+} SpawnError;
+
+// 在父进程中准备好的子进程设置，vfork子进程中只执行系统调用，不申请内存
+typedef struct {
+    std::string path;        // argv[0]按PATH查找后的路径
+    std::vector<char *> args;
+    int nice;
+    bool has_cpus;
+    cpu_set_t cpus;
+    const std::vector<std::pair<int, rlim_t>> *rlimits;
+    std::string cgroup_procs; // 空表示不加入cgroup
+    int out_fd;
+    int err_fd;
+} SpawnPlan;
+
+static const char *spawn_stage_name(int stage)
+{
+    switch (stage) {
+        case SPAWN_CGROUP:
+            return "join cgroup";
+        case SPAWN_NICE:
+            return "set nice";
+        case SPAWN_CPUS:
+            return "set cpu affinity";
+        case SPAWN_RLIMIT:
+            return "set rlimit";
+        default:
+            return "exec";
+    }
+}
+
+// 按PATH查找可执行文件，含'/'时直接使用
+static std::string find_executable(const std::string &name)
+{
+    if (name.find('/') != std::string::npos) {
+        return access(name.c_str(), X_OK) == 0 ? name : "";
+    }
+    const char *env = getenv("PATH");
+    std::string paths = env != nullptr ? env : "/usr/local/bin:/usr/bin:/bin";
+    size_t pos = 0;
+    while (pos <= paths.size()) {
+        size_t end = paths.find(':', pos);
+        if (end == std::string::npos) {
+            end = paths.size();
+        }
+        std::string dir = paths.substr(pos, end - pos);
+        std::string path = (dir.empty() ? "." : dir) + "/" + name;
+        if (access(path.c_str(), X_OK) == 0) {
+            return path;
+        }
+        pos = end + 1;
+    }
+    return "";
+}
+
+static void report_spawn_error(int fd, int stage, int arg, int err)
+{
+    SpawnError error{stage, arg, err};
+    ssize_t ret = write(fd, &error, sizeof(error));
+    (void)ret;
+}
+
+// vfork子进程中执行：与父进程共享内存，只调用异步信号安全的函数。
+// 资源限制在exec前对子进程自身设置，其后代进程（如llvm-bolt）全部继承
+[[noreturn]] static void exec_child(const SpawnPlan &plan)
+{
+    // 恢复插件进程设置的信号处理和屏蔽
+    struct sigaction dfl;
+    memset(&dfl, 0, sizeof(dfl));
+    dfl.sa_handler = SIG_DFL;
+    for (int sig = 1; sig < NSIG; ++sig) {
+        sigaction(sig, &dfl, nullptr);
+    }
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigprocmask(SIG_SETMASK, &mask, nullptr);
+
+    // 子进程位于独立进程组，便于终止其全部后代
+    setpgid(0, 0);
+    int null_fd = open("/dev/null", O_RDONLY);
+    if (null_fd >= 0 && null_fd != STDIN_FILENO) {
+        dup2(null_fd, STDIN_FILENO);
+        close(null_fd);
+    }
+    dup2(plan.out_fd, STDOUT_FILENO);
+    dup2(plan.out_fd, STDERR_FILENO);
+
+    if (!plan.cgroup_procs.empty()) {
+        // 写入0表示将写入者自身加入该cgroup
+        int fd = open(plan.cgroup_procs.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd < 0 || write(fd, "0", 1) != 1) {
+            report_spawn_error(plan.err_fd, SPAWN_CGROUP, 0, errno);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    if (plan.nice != 0 && setpriority(PRIO_PROCESS, 0, plan.nice) != 0) {
+        report_spawn_error(plan.err_fd, SPAWN_NICE, 0, errno);
+    }
+    if (plan.has_cpus && sched_setaffinity(0, sizeof(plan.cpus), &plan.cpus) != 0) {
+        report_spawn_error(plan.err_fd, SPAWN_CPUS, 0, errno);
+    }
+    for (const auto &limit : *plan.rlimits) {
+        struct rlimit rlim = {limit.second, limit.second};
+        if (setrlimit((enum __rlimit_resource)limit.first, &rlim) != 0) {
+            report_spawn_error(plan.err_fd, SPAWN_RLIMIT, limit.first, errno);
+        }
+    }
+
+    execve(plan.path.c_str(), plan.args.data(), environ);
+    report_spawn_error(plan.err_fd, SPAWN_EXEC, 0, errno);
+    _exit(127);
+}
+
+static pid_t spawn_process(const std::vector<std::string> &argv, const ExecOptions &options, int out_fd)
+{
+    SpawnPlan plan;
+    plan.path = find_executable(argv[0]);
+    if (plan.path.empty()) {
+        ERROR("[run] spawn " << argv[0] << " failed: command not found");
+        return -1;
+    }
+    for (const std::string &arg : argv) {
+        plan.args.push_back(const_cast<char *>(arg.c_str()));
+    }
+    plan.args.push_back(nullptr);
+    plan.nice = options.nice;
+    plan.has_cpus = options.cpus != "" && parse_cpu_list(options.cpus, &plan.cpus);
+    if (options.cpus != "" && !plan.has_cpus) {
+        WARN("[run] invalid cpu list " << options.cpus << ", ignored");
+    }
+    plan.rlimits = &options.rlimits;
+    plan.cgroup_procs = options.cgroup == "" ? "" : options.cgroup + "/cgroup.procs";
+    plan.out_fd = out_fd;
+
+    // 错误管道写端为CLOEXEC，子进程exec成功后自动关闭
+    int err_fds[2];
+    if (pipe2(err_fds, O_CLOEXEC) != 0) {
+        ERROR("[run] create pipe failed: " << strerror(errno));
+        return -1;
+    }
+    plan.err_fd = err_fds[1];
+
+    // 屏蔽全部信号，避免插件进程的信号处理函数在共享内存的子进程中执行
+    sigset_t all;
+    sigset_t old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    pid_t pid = vfork();
+    if (pid == 0) {
+        exec_child(plan);
+    }
+    int err = errno;
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    close(err_fds[1]);
+    if (pid < 0) {
+        close(err_fds[0]);
+        ERROR("[run] spawn " << argv[0] << " failed: " << strerror(err));
+        return -1;
+    }
+
+    // vfork返回时子进程已exec或退出，读取其上报的全部错误
+    bool exec_failed = false;
+    SpawnError error;
+    while (read(err_fds[0], &error, sizeof(error)) == (ssize_t)sizeof(error)) {
+        if (error.stage == SPAWN_EXEC) {
+            exec_failed = true;
+            ERROR("[run] spawn " << argv[0] << " failed: " << strerror(error.err));
+        } else {
+            WARN("[run] " << spawn_stage_name(error.stage) << (error.stage == SPAWN_RLIMIT ?
+                " " + std::to_string(error.arg) : "") << " for \"" << argv[0] << "\" failed: " << strerror(error.err));
+        }
+    }
+    close(err_fds[0]);
+    if (exec_failed) {
+        waitpid(pid, nullptr, 0);
+        return -1;
+    }
+    return pid;
+}
+
+exec_result exec_cmd(const std::vector<std::string> &argv, const ExecOptions &options)
+{
+    exec_result result{"", -1, false, false, 0, 0};
+    if (argv.empty()) {
+        return result;
+    }
+    DEBUG("exec cmd: \"" << format_cmd(argv) << "\"");
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        ERROR("[run] create pipe failed: " << strerror(errno));
+        return result;
+    }
+    // 加大管道容量，减少子进程输出较多时的阻塞和读取次数
+    fcntl(fds[0], F_SETPIPE_SZ, EXEC_PIPE_SIZE);
+    int64_t start = get_current_timestamp();
+    pid_t pid = spawn_process(argv, options, fds[1]);
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        return result;
+    }
+
+    int fd = fds[0];
+    int status = 0;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    bool reaped = false;
+    bool lost = false;
+    int64_t reaped_ts = 0;
+    int64_t term_ts = 0;
+    std::vector<char> buffer(64 * 1024);
+    while (true) {
+        if (!reaped) {
+            pid_t ret = wait4(pid, &status, WNOHANG, &usage);
+            // 子进程已被其他地方回收（如SIGCHLD被设置为SIG_IGN）时返回ECHILD，退出码无法获取
+            if (ret < 0 && errno != EINTR) {
+                WARN("[run] wait \"" << argv[0] << "\" (pid " << pid << ") failed: " << strerror(errno));
+                lost = true;
+            }
+            if (ret == pid || lost) {
+                reaped = true;
+                reaped_ts = get_current_timestamp();
+            }
+        }
+        int64_t now = get_current_timestamp();
+        if (reaped && (fd < 0 || now - reaped_ts >= EXEC_DRAIN_TIME)) {
+            break;
+        }
+
+        // 超时或取消时先SIGTERM，宽限期后SIGKILL，信号发送给整个进程组
+        if (!reaped) {
+            bool cancel = options.cancel != nullptr && options.cancel->load();
+            bool timeout = options.timeout > 0 && now - start >= options.timeout;
+            if ((cancel || timeout) && term_ts == 0) {
+                result.cancelled = cancel;
+                result.timed_out = !cancel;
+                WARN("[run] " << (cancel ? "cancel" : "timeout") << ", terminate \"" << argv[0]
+                    << "\" (pid " << pid << ")");
+                kill(-pid, SIGTERM);
+                term_ts = now;
+            } else if (term_ts != 0 && now - term_ts >= EXEC_KILL_GRACE) {
+                kill(-pid, SIGKILL);
+            }
+        }
+
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int ready = poll(&pfd, fd >= 0 ? 1 : 0, EXEC_POLL_INTERVAL);
+        if (ready > 0 && (pfd.revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t n = read(fd, buffer.data(), buffer.size());
+            if (n > 0) {
+                size_t keep = std::min((size_t)n, EXEC_OUTPUT_LIMIT - std::min(result.cmd_log.size(),
+                    (size_t)EXEC_OUTPUT_LIMIT));
+                result.cmd_log.append(buffer.data(), keep);
+            } else if (n == 0 || errno != EINTR) {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    result.elapsed = get_current_timestamp() - start;
+    result.max_rss = usage.ru_maxrss;
+    if (lost) {
+        result.ret = -1;
+    } else if (WIFEXITED(status)) {
+        result.ret = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        result.ret = 128 + WTERMSIG(status);
+    }
+    return result;
+}
@@ -0,0 +1,305 @@
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+
+#include "logs.h"
+#include "utils.h"
+#include "process_tracker.h"
+
+ProcessTracker process_tracker;
+
+// 读取/proc/<pid>/exe对应的应用，非目标应用或进程已退出时返回false
+static bool lookup_process(pid_t pid, TrackedProcess *process)
+{
+    char link[64];
+    char exe[PATH_MAX];
+    snprintf(link, sizeof(link), "/proc/%d/exe", pid);
+    ssize_t len = readlink(link, exe, sizeof(exe) - 1);
+    if (len <= 0) {
+        return false;
+    }
+    exe[len] = '\0';
+    auto it = configs->path_index.find(exe);
+    if (it == configs->path_index.end()) {
+        return false;
+    }
+    const size_t suffix_len = strlen(".rto");
+    process->app = it->second;
+    process->optimized = (size_t)len > suffix_len && strcmp(exe + len - suffix_len, ".rto") == 0;
+    return true;
+}
+
+static bool send_mcast_op(int sock, enum proc_cn_mcast_op op)
+{
+    alignas(struct nlmsghdr) char buffer[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(op))];
+    memset(buffer, 0, sizeof(buffer));
+    struct nlmsghdr *nlh = (struct nlmsghdr *)buffer;
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(op));
+    nlh->nlmsg_type = NLMSG_DONE;
+    struct cn_msg *msg = (struct cn_msg *)NLMSG_DATA(nlh);
+    msg->id.idx = CN_IDX_PROC;
+    msg->id.val = CN_VAL_PROC;
+    msg->len = sizeof(op);
+    memcpy(msg->data, &op, sizeof(op));
+    return send(sock, buffer, nlh->nlmsg_len, 0) == (ssize_t)nlh->nlmsg_len;
+}
+
+// 订阅进程事件，需要CAP_NET_ADMIN，失败时退化为扫描/proc
+bool ProcessTracker::subscribe()
+{
+    int fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (fd < 0) {
+        return false;
+    }
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = CN_IDX_PROC;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || !send_mcast_op(fd, PROC_CN_MCAST_LISTEN)) {
+        WARN("[enable] subscribe process events failed: " << strerror(errno));
+        close(fd);
+        return false;
+    }
+    // 加大接收缓冲，减少进程创建高峰时的事件丢失
+    int size = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    sock = fd;
+    return true;
+}
+
+void ProcessTracker::start()
+{
+    stop();
+    // 先订阅再扫描，扫描期间发生的事件缓存在socket中，之后按顺序处理
+    bool event_mode = subscribe();
+    scan();
+    if (event_mode) {
+        running = true;
+        worker = std::thread(&ProcessTracker::event_loop, this);
+    }
+    INFO("[enable] process tracker started in " << (event_mode ? "event" : "scan")
+        << " mode, tracked processes: " << procs.size());
+}
+
+void ProcessTracker::stop()
+{
+    running = false;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    int fd = sock.exchange(-1);
+    if (fd >= 0) {
+        send_mcast_op(fd, PROC_CN_MCAST_IGNORE);
+        close(fd);
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    procs.clear();
+    live.clear();
+    last_scan = 0;
+}
+
+void ProcessTracker::track(pid_t pid, const TrackedProcess &process)
+{
+    untrack(pid);
+    procs[pid] = process;
+    live[process.app].insert(pid);
+}
+
+void ProcessTracker::untrack(pid_t pid)
+{
+    auto it = procs.find(pid);
+    if (it == procs.end()) {
+        return;
+    }
+    auto pids = live.find(it->second.app);
+    if (pids != live.end()) {
+        pids->second.erase(pid);
+        if (pids->second.empty()) {
+            live.erase(pids);
+        }
+    }
+    procs.erase(it);
+}
+
+bool ProcessTracker::track_exe(pid_t pid)
+{
+    TrackedProcess process;
+    if (!lookup_process(pid, &process)) {
+        untrack(pid);
+        return false;
+    }
+    track(pid, process);
+    return true;
+}
+
+// 全量扫描/proc重建进程表，扫描时不持锁
+void ProcessTracker::scan()
+{
+    std::unordered_map<pid_t, TrackedProcess> found;
+    DIR *dir = opendir("/proc");
+    if (dir == nullptr) {
+        ERROR("[run] open /proc failed: " << strerror(errno));
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        char *end = nullptr;
+        long pid = strtol(entry->d_name, &end, 10);
+        TrackedProcess process;
+        if (*end == '\0' && pid > 0 && lookup_process((pid_t)pid, &process)) {
+            found[(pid_t)pid] = process;
+        }
+    }
+    closedir(dir);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    procs.clear();
+    live.clear();
+    for (const auto &item : found) {
+        track(item.first, item.second);
+    }
+    scans++;
+}
+
+void ProcessTracker::handle_events(const char *buffer, ssize_t len)
+{
+    int remaining = (int)len;
+    std::lock_guard<std::mutex> lock(mtx);
+    for (const struct nlmsghdr *nlh = (const struct nlmsghdr *)buffer; NLMSG_OK(nlh, remaining);
+        nlh = NLMSG_NEXT(nlh, remaining)) {
+        if (nlh->nlmsg_type == NLMSG_ERROR || nlh->nlmsg_type == NLMSG_NOOP) {
+            continue;
+        }
+        const struct cn_msg *msg = (const struct cn_msg *)NLMSG_DATA(nlh);
+        if (msg->id.idx != CN_IDX_PROC || msg->id.val != CN_VAL_PROC) {
+            continue;
+        }
+        const struct proc_event *event = (const struct proc_event *)msg->data;
+        events++;
+        switch (event->what) {
+            case proc_event::PROC_EVENT_FORK: {
+                // 只跟踪新进程，忽略新线程；fork后未exec的子进程与父进程运行同一二进制
+                pid_t child = event->event_data.fork.child_tgid;
+                auto parent = procs.find(event->event_data.fork.parent_tgid);
+                if (event->event_data.fork.child_pid == child && parent != procs.end()) {
+                    track(child, parent->second);
+                }
+                break;
+            }
+            case proc_event::PROC_EVENT_EXEC:
+                track_exe(event->event_data.exec.process_tgid);
+                break;
+            case proc_event::PROC_EVENT_EXIT:
+                if (event->event_data.exit.process_pid == event->event_data.exit.process_tgid) {
+                    untrack(event->event_data.exit.process_tgid);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void ProcessTracker::event_loop()
+{
+    alignas(struct nlmsghdr) char buffer[64 * 1024];
+    while (running) {
+        int fd = sock;
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, PROCESS_EVENT_POLL_INTERVAL) <= 0) {
+            continue;
+        }
+        struct sockaddr_nl from;
+        socklen_t from_len = sizeof(from);
+        ssize_t len = recvfrom(fd, buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &from_len);
+        if (len < 0) {
+            // 接收缓冲溢出时事件已丢失，重新扫描保证进程表正确
+            if (errno == ENOBUFS) {
+                WARN("[run] process events overflow, rescan /proc");
+                scan();
+            }
+            continue;
+        }
+        // 只接受内核发送的事件
+        if (from.nl_pid != 0) {
+            continue;
+        }
+        handle_events(buffer, len);
+    }
+}
+
+// 扫描模式下进程表不会自动更新，查询前按PROCESS_SCAN_PERIOD限频重新扫描
+void ProcessTracker::refresh()
+{
+    if (sock >= 0) {
+        return;
+    }
+    int64_t now = get_current_timestamp();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (now - last_scan < PROCESS_SCAN_PERIOD) {
+            return;
+        }
+        last_scan = now;
+    }
+    scan();
+}
+
+pid_t ProcessTracker::find(AppConfig *app, bool *optimized)
+{
+    refresh();
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = live.find(app);
+    if (it == live.end()) {
+        return -1;
+    }
+    pid_t pid = *it->second.begin();
+    if (optimized != nullptr) {
+        *optimized = procs[pid].optimized;
+    }
+    return pid;
+}
+
+std::vector<pid_t> ProcessTracker::pids(AppConfig *app)
+{
+    refresh();
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = live.find(app);
+    if (it == live.end()) {
+        return std::vector<pid_t>();
+    }
+    return std::vector<pid_t>(it->second.begin(), it->second.end());
+}
+
+bool ProcessTracker::lookup(pid_t pid, TrackedProcess *process)
+{
+    refresh();
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = procs.find(pid);
+    if (it == procs.end()) {
+        return false;
+    }
+    *process = it->second;
+    return true;
+}
+
+void ProcessTracker::debug_print()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    DEBUG("[DFOT_TRACKER] mode: " << (sock >= 0 ? "event" : "scan") << ", tracked processes: " << procs.size()
+        << ", events: " << events << ", scans: " << scans);
+    for (const auto &item : live) {
+        std::string pids;
+        for (pid_t pid : item.second) {
+            pids += " " + std::to_string(pid) + (procs[pid].optimized ? "(rto)" : "");
+        }
+        DEBUG("[DFOT_TRACKER] " << item.first->app_name << ":" << pids);
+    }
+}
@@ -0,0 +1,213 @@
+#include <algorithm>
+
+#include "profile.h"
+
+uint32_t SymbolTable::intern(const char *name)
+{
+    auto it = index.find(std::string_view(name));
+    if (it != index.end()) {
+        return it->second;
+    }
+    uint32_t id = (uint32_t)names.size();
+    names.emplace_back(name);
+    index.emplace(std::string_view(names.back()), id);
+    return id;
+}
+
+void SymbolTable::clear()
+{
+    index.clear();
+    names.clear();
+}
+
+// 清空内存中的profile数据
+void profile_clear(Profile &profile)
+{
+    profile.addrs.clear();
+    profile.funcs.clear();
+    profile.symbols.clear();
+    profile.buckets.clear();
+    profile.epoch_ts = 0;
+    profile.convergence = ConvergenceState{0, 0, {}};
+    profile.ckpt_reset = true;
+    profile.ckpt_erased.clear();
+    profile.ts = 0;
+}
+
+// 获取函数名对应的ID，首次出现的函数同时创建其偏移直方图
+uint32_t profile_intern_func(Profile &profile, const char *name)
+{
+    uint32_t id = profile.symbols.intern(name);
+    if (id >= profile.funcs.size()) {
+        profile.funcs.resize(id + 1, FlatMap<int>(4));
+    }
+    return id;
+}
+
+// 按函数名字典序返回函数ID，保证导出顺序与按名字排序的map一致
+std::vector<uint32_t> profile_sorted_funcs(const Profile &profile)
+{
+    std::vector<uint32_t> ids(profile.funcs.size());
+    for (uint32_t i = 0; i < ids.size(); ++i) {
+        ids[i] = i;
+    }
+    std::sort(ids.begin(), ids.end(), [&profile](uint32_t a, uint32_t b) {
+        return profile.symbols.name(a) < profile.symbols.name(b);
+    });
+    return ids;
+}
+
+// 从地址计数及对应的函数直方图中扣除count，计数归零的条目被删除
+static void profile_subtract(Profile &profile, uint64_t addr, int count)
+{
+    AddrInfo *info = profile.addrs.find(addr);
+    if (info == nullptr) {
+        return;
+    }
+    if (info->sym < profile.funcs.size()) {
+        auto &offsets = profile.funcs[info->sym];
+        int *func_count = offsets.find(info->offset);
+        if (func_count != nullptr && (*func_count -= count) <= 0) {
+            offsets.erase(info->offset);
+        }
+    }
+    if ((info->count -= count) <= 0) {
+        if (info->saved != 0) {
+            profile.ckpt_erased.emplace_back(addr, info->saved);
+        }
+        profile.addrs.erase(addr);
+    }
+}
+
+// 所有计数按系数衰减（向下取整），计数归零的条目被删除
+static void profile_decay(Profile &profile, double factor)
+{
+    std::vector<uint64_t> expired;
+    profile.addrs.for_each([&](uint64_t addr, AddrInfo &info) {
+        int decayed = (int)(info.count * factor);
+        if (decayed < info.count) {
+            // 先按差值扣除函数直方图，再统一删除归零的地址，避免遍历中修改表结构
+            int delta = info.count - decayed;
+            if (info.sym < profile.funcs.size()) {
+                int *func_count = profile.funcs[info.sym].find(info.offset);
+                if (func_count != nullptr && (*func_count -= delta) <= 0) {
+                    profile.funcs[info.sym].erase(info.offset);
+                }
+            }
+            info.count = decayed;
+        }
+        if (info.count <= 0) {
+            expired.push_back(addr);
+            if (info.saved != 0) {
+                profile.ckpt_erased.emplace_back(addr, info.saved);
+            }
+        }
+    });
+    for (uint64_t addr : expired) {
+        profile.addrs.erase(addr);
+    }
+}
+
+// 按采样时间推进时间窗口：分桶模式下老化最老的桶，衰减模式下对历史计数衰减
+void profile_advance_window(Profile &profile, const ProfileWindow &window, int64_t ts)
+{
+    if (window.mode == WINDOW_RESET || window.epoch_len <= 0) {
+        return;
+    }
+    if (profile.epoch_ts == 0) {
+        profile.epoch_ts = ts;
+        if (window.mode == WINDOW_BUCKETS) {
+            profile.buckets.emplace_back();
+        }
+        return;
+    }
+    if (ts < profile.epoch_ts + window.epoch_len) {
+        return;
+    }
+
+    int64_t epochs = (ts - profile.epoch_ts) / window.epoch_len;
+    profile.epoch_ts += epochs * window.epoch_len;
+    if (window.mode == WINDOW_DECAY) {
+        // 跨越多个周期时累计衰减，计数全部归零后无需逐个周期处理
+        for (int64_t i = 0; i < epochs && profile.addrs.size() > 0; ++i) {
+            profile_decay(profile, window.decay_factor);
+        }
+        return;
+    }
+
+    for (int64_t i = 0; i < epochs && i < window.buckets; ++i) {
+        profile.buckets.emplace_back();
+    }
+    while ((int)profile.buckets.size() > window.buckets) {
+        profile.buckets.front().for_each([&profile](uint64_t addr, int count) {
+            profile_subtract(profile, addr, count);
+        });
+        profile.buckets.pop_front();
+    }
+    // profile的起始时间更新为最老时间桶的起始时间
+    profile.ts = profile.epoch_ts - (int64_t)(profile.buckets.size() - 1) * window.epoch_len;
+}
+
+// 记录采样到当前时间桶，用于老化时扣除
+void profile_window_add(Profile &profile, const ProfileWindow &window, uint64_t addr, int weight)
+{
+    if (window.mode != WINDOW_BUCKETS || profile.buckets.empty()) {
+        return;
+    }
+    profile.buckets.back()[addr] += weight;
+}
+
+// 函数ID与地址共用key空间，函数ID置最高位，用户态地址不会与之冲突
+#define HOT_FUNC_KEY(sym) ((uint64_t)(sym) | (1ULL << 63))
+
+// 统计热点分布：已解析函数按函数汇总，其余按地址统计，返回计数最多的top_n个及其占总采样数的比例
+HotShares profile_hot_shares(const Profile &profile, int top_n, int64_t *total)
+{
+    FlatMap<int64_t> counts(profile.funcs.size() + 16);
+    *total = 0;
+    profile.addrs.for_each([&](uint64_t addr, const AddrInfo &info) {
+        uint64_t key = info.sym < profile.funcs.size() ? HOT_FUNC_KEY(info.sym) : addr;
+        counts[key] += info.count;
+        *total += info.count;
+    });
+
+    std::vector<std::pair<uint64_t, int64_t>> hot;
+    hot.reserve(counts.size());
+    counts.for_each([&hot](uint64_t key, int64_t count) {
+        hot.emplace_back(key, count);
+    });
+    size_t n = std::min(hot.size(), (size_t)std::max(top_n, 0));
+    std::partial_sort(hot.begin(), hot.begin() + n, hot.end(),
+        [](const auto &a, const auto &b) { return a.second > b.second; });
+    hot.resize(n);
+    std::sort(hot.begin(), hot.end());
+
+    HotShares shares;
+    shares.reserve(n);
+    for (const auto &item : hot) {
+        shares.emplace_back(item.first, (double)item.second / *total);
+    }
+    return shares;
+}
+
+// 加权Jaccard相似度：sum(min) / sum(max)，取值[0, 1]，热点集合及其占比都不变时为1
+double hot_shares_similarity(const HotShares &a, const HotShares &b)
+{
+    double min_sum = 0;
+    double max_sum = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() || j < b.size()) {
+        if (j == b.size() || (i < a.size() && a[i].first < b[j].first)) {
+            max_sum += a[i++].second;
+        } else if (i == a.size() || b[j].first < a[i].first) {
+            max_sum += b[j++].second;
+        } else {
+            min_sum += std::min(a[i].second, b[j].second);
+            max_sum += std::max(a[i].second, b[j].second);
+            i++;
+            j++;
+        }
+    }
+    return max_sum > 0 ? min_sum / max_sum : 0;
+}
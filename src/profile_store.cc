@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+
+#include <boost/filesystem.hpp>
+
+#include "logs.h"
+#include "elf_symbols.h"
+#include "profile_writer.h"
+#include "profile_store.h"
+
+static void append_varint(std::string &out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+static bool read_varint(const uint8_t *&pos, const uint8_t *end, uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+        uint8_t byte = *pos++;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string profile_store_path(const std::string &dir, const std::string &app_name,
+    const std::string &identity, uint64_t generation)
+{
+    return dir + "/" + app_name + "_" + identity + "." + std::to_string(generation) + PROFILE_STORE_SUFFIX;
+}
+
+std::vector<uint64_t> profile_store_generations(const std::string &dir, const std::string &app_name,
+    const std::string &identity)
+{
+    std::vector<uint64_t> generations;
+    std::string prefix = app_name + "_" + identity + ".";
+    std::string suffix = PROFILE_STORE_SUFFIX;
+    boost::system::error_code ec;
+    for (boost::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        std::string number = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+        if (number.find_first_not_of("0123456789") == std::string::npos) {
+            generations.push_back(std::stoull(number));
+        }
+    }
+    std::sort(generations.begin(), generations.end());
+    return generations;
+}
+
+// 删除该应用其他二进制标识的版本，二进制标识长度固定，避免误删名称以该应用名为前缀的其他应用的文件
+static void profile_store_remove_stale(const std::string &dir, const std::string &app_name,
+    const std::string &identity)
+{
+    std::string prefix = app_name + "_";
+    std::string suffix = PROFILE_STORE_SUFFIX;
+    boost::system::error_code ec;
+    std::vector<boost::filesystem::path> stale;
+    for (boost::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        size_t dot = prefix.size() + identity.size();
+        if (name.size() <= dot + 1 + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+            name[dot] != '.' || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0 ||
+            name.compare(prefix.size(), identity.size(), identity) == 0) {
+            continue;
+        }
+        std::string number = name.substr(dot + 1, name.size() - dot - 1 - suffix.size());
+        if (number.find_first_not_of("0123456789") == std::string::npos) {
+            stale.push_back(it->path());
+        }
+    }
+    for (const auto &path : stale) {
+        INFO("[run] binary of " << app_name << " changed, remove stale profile " << path.string());
+        std::remove(path.c_str());
+    }
+}
+
+int profile_store_save(const Profile &profile, const std::string &dir, const std::string &app_name,
+    const std::string &identity, int history, int64_t ts)
+{
+    std::vector<ProfileStoreFunc> funcs;
+    std::string strtab;
+    std::string data;
+    for (uint32_t id : profile_sorted_funcs(profile)) {
+        const FlatMap<int> &offsets = profile.funcs[id];
+        if (offsets.empty()) {
+            continue;
+        }
+        funcs.push_back(ProfileStoreFunc{(uint32_t)strtab.size(), (uint32_t)offsets.size(), data.size()});
+        strtab.append(profile.symbols.name(id));
+        strtab.push_back('\0');
+        uint64_t last = 0;
+        for (uint64_t offset : offsets.sorted_keys()) {
+            append_varint(data, offset - last);
+            append_varint(data, (uint64_t)*offsets.find(offset));
+            last = offset;
+        }
+    }
+
+    std::vector<uint64_t> generations = profile_store_generations(dir, app_name, identity);
+    uint64_t generation = generations.empty() ? 1 : generations.back() + 1;
+    std::string path = profile_store_path(dir, app_name, identity, generation);
+
+    ProfileStoreHeader header;
+    memcpy(header.magic, PROFILE_STORE_MAGIC, sizeof(header.magic));
+    header.ts = ts;
+    header.func_count = funcs.size();
+    header.reserved = 0;
+    header.strtab_size = strtab.size();
+    header.data_size = data.size();
+    ProfileWriter writer;
+    if (writer.open(path) != DFOT_OK) {
+        return DFOT_ERROR;
+    }
+    writer.append(std::string_view((const char *)&header, sizeof(header)));
+    writer.append(std::string_view((const char *)funcs.data(), funcs.size() * sizeof(ProfileStoreFunc)));
+    writer.append(strtab).append(data);
+    if (writer.commit() != DFOT_OK) {
+        return DFOT_ERROR;
+    }
+    INFO("[run] saved profile generation " << generation << " to " << path
+        << ", " << funcs.size() << " functions, " << writer.bytes() << " bytes");
+
+    // 只保留最近history个版本，最新版本是下一次优化的输入，始终保留
+    generations.push_back(generation);
+    size_t keep = std::max(history, 1);
+    for (size_t i = 0; i + keep < generations.size(); ++i) {
+        std::remove(profile_store_path(dir, app_name, identity, generations[i]).c_str());
+    }
+    profile_store_remove_stale(dir, app_name, identity);
+    return DFOT_OK;
+}
+
+StoredProfile::~StoredProfile()
+{
+    unload();
+}
+
+void StoredProfile::unload()
+{
+    if (map != nullptr) {
+        munmap(map, map_size);
+    }
+    map = nullptr;
+    map_size = 0;
+    header = nullptr;
+    funcs = nullptr;
+    strtab = nullptr;
+    data = nullptr;
+}
+
+int StoredProfile::load(const std::string &path)
+{
+    unload();
+    MappedFile file{nullptr, 0};
+    if (map_file(path, &file) != DFOT_OK) {
+        return DFOT_ERROR;
+    }
+    const ProfileStoreHeader *hdr = (const ProfileStoreHeader *)file.data;
+    if (file.size < sizeof(ProfileStoreHeader) ||
+        memcmp(hdr->magic, PROFILE_STORE_MAGIC, sizeof(hdr->magic)) != 0 ||
+        sizeof(ProfileStoreHeader) + hdr->func_count * sizeof(ProfileStoreFunc) +
+        hdr->strtab_size + hdr->data_size != file.size) {
+        ERROR("[run] invalid stored profile " << path);
+        unmap_file(&file);
+        return DFOT_ERROR;
+    }
+    map = (void *)file.data;
+    map_size = file.size;
+    header = hdr;
+    funcs = (const ProfileStoreFunc *)(file.data + sizeof(ProfileStoreHeader));
+    strtab = (const char *)(funcs + hdr->func_count);
+    data = (const uint8_t *)(strtab + hdr->strtab_size);
+    return DFOT_OK;
+}
+
+std::string_view StoredProfile::name(uint32_t index) const
+{
+    uint32_t pos = funcs[index].name;
+    if (pos >= header->strtab_size) {
+        return std::string_view();
+    }
+    return std::string_view(strtab + pos, strnlen(strtab + pos, header->strtab_size - pos));
+}
+
+int StoredProfile::for_each(uint32_t index, const std::function<void(uint64_t, uint64_t)> &f) const
+{
+    const ProfileStoreFunc &func = funcs[index];
+    if (func.data >= header->data_size && func.count > 0) {
+        return DFOT_ERROR;
+    }
+    const uint8_t *pos = data + func.data;
+    const uint8_t *end = data + header->data_size;
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < func.count; ++i) {
+        uint64_t delta = 0;
+        uint64_t count = 0;
+        if (!read_varint(pos, end, &delta) || !read_varint(pos, end, &count)) {
+            return DFOT_ERROR;
+        }
+        offset += delta;
+        f(offset, count);
+    }
+    return DFOT_OK;
+}
+
+void profile_merge_stored(Profile &profile, const StoredProfile &stored, double weight)
+{
+    for (uint32_t i = 0; i < stored.size(); ++i) {
+        std::string name(stored.name(i));
+        uint32_t id = UINT32_MAX;
+        stored.for_each(i, [&](uint64_t offset, uint64_t count) {
+            int weighted = (int)(count * weight);
+            if (weighted <= 0) {
+                return;
+            }
+            // 只有存在有效计数时才登记函数，避免衰减完的函数残留在profile中
+            if (id == UINT32_MAX) {
+                id = profile_intern_func(profile, name.c_str());
+            }
+            profile.funcs[id][offset] += weighted;
+        });
+    }
+}
+
+// 按采样数从高到低选取函数，直到覆盖coverage（取值(0, 1]）比例的采样
+static int export_hot_funcs(const StoredProfile &stored, const std::string &path, double coverage)
+{
+    std::vector<std::pair<uint32_t, uint64_t>> counts;
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < stored.size(); ++i) {
+        uint64_t count = 0;
+        stored.for_each(i, [&count](uint64_t, uint64_t value) { count += value; });
+        if (count > 0) {
+            counts.emplace_back(i, count);
+            total += count;
+        }
+    }
+    std::stable_sort(counts.begin(), counts.end(),
+        [](const auto &a, const auto &b) { return a.second > b.second; });
+
+    ProfileWriter writer;
+    if (writer.open(path) != DFOT_OK) {
+        return DFOT_ERROR;
+    }
+    size_t hot = 0;
+    uint64_t covered = 0;
+    for (const auto &item : counts) {
+        if (covered >= coverage * total) {
+            break;
+        }
+        writer.append(stored.name(item.first)).append('\n');
+        covered += item.second;
+        hot++;
+    }
+    if (writer.commit() != DFOT_OK) {
+        return DFOT_ERROR;
+    }
+    INFO("- Hot     : " << hot << "/" << counts.size() << " functions cover "
+        << coverage * 100 << "% of " << total << " samples");
+    return DFOT_OK;
+}
+
+int profile_store_export(const std::string &path, const std::string &fdata, double hot_coverage)
+{
+    StoredProfile stored;
+    if (stored.load(path) != DFOT_OK) {
+        return DFOT_ERROR;
+    }
+    // 函数表按函数名排序、偏移升序保存，顺序输出即与直接导出的profile一致
+    ProfileWriter writer;
+    if (writer.open(fdata) != DFOT_OK) {
+        return DFOT_ERROR;
+    }
+    // 当前仅处理pmu_sampling_collector数据，性能事件固定为cycles
+    writer.append("no_lbr cycles:\n");
+    for (uint32_t i = 0; i < stored.size(); ++i) {
+        std::string_view name = stored.name(i);
+        int ret = stored.for_each(i, [&writer, name](uint64_t offset, uint64_t count) {
+            writer.append("1 ").append(name).append(' ').append_hex(offset)
+                .append(' ').append_dec((int64_t)count).append('\n');
+        });
+        if (ret != DFOT_OK) {
+            ERROR("[run] stored profile " << path << " is corrupted");
+            writer.abort();
+            return DFOT_ERROR;
+        }
+    }
+    if (writer.commit() != DFOT_OK) {
+        return DFOT_ERROR;
+    }
+    INFO("[run] converted " << path << " to " << fdata << ", " << writer.bytes() << " bytes");
+
+    std::string funcs_path = fdata + HOT_FUNCS_SUFFIX;
+    if (hot_coverage <= 0 || stored.size() == 0) {
+        std::remove(funcs_path.c_str());
+        return DFOT_OK;
+    }
+    // 热点函数列表写入失败时优化全部函数
+    if (export_hot_funcs(stored, funcs_path, hot_coverage) != DFOT_OK) {
+        WARN("[run] write hot functions of " << path << " failed");
+        std::remove(funcs_path.c_str());
+    }
+    return DFOT_OK;
+}
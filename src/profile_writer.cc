@@ -0,0 +1,115 @@
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "logs.h"
+#include "profile_writer.h"
+
+ProfileWriter::~ProfileWriter()
+{
+    abort();
+}
+
+int ProfileWriter::open(const std::string &target)
+{
+    abort();
+    path = target;
+    tmp_path = target + ".tmp";
+    fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ERROR("[run] open " << tmp_path << " error: " << strerror(errno));
+        return DFOT_ERROR;
+    }
+    failed = false;
+    written = 0;
+    buffer.clear();
+    buffer.reserve(PROFILE_WRITER_BUFFER_SIZE);
+    return DFOT_OK;
+}
+
+int ProfileWriter::flush()
+{
+    size_t pos = 0;
+    while (!failed && pos < buffer.size()) {
+        ssize_t ret = ::write(fd, buffer.data() + pos, buffer.size() - pos);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            ERROR("[run] write " << tmp_path << " error: " << strerror(errno));
+            failed = true;
+            break;
+        }
+        pos += ret;
+    }
+    written += pos;
+    buffer.clear();
+    return failed ? DFOT_ERROR : DFOT_OK;
+}
+
+ProfileWriter &ProfileWriter::append(std::string_view str)
+{
+    if (buffer.size() + str.size() > PROFILE_WRITER_BUFFER_SIZE) {
+        flush();
+    }
+    buffer.append(str);
+    return *this;
+}
+
+ProfileWriter &ProfileWriter::append(char c)
+{
+    if (buffer.size() + 1 > PROFILE_WRITER_BUFFER_SIZE) {
+        flush();
+    }
+    buffer.push_back(c);
+    return *this;
+}
+
+ProfileWriter &ProfileWriter::append_dec(int64_t value)
+{
+    char str[24];
+    auto result = std::to_chars(str, str + sizeof(str), value);
+    return append(std::string_view(str, result.ptr - str));
+}
+
+ProfileWriter &ProfileWriter::append_hex(uint64_t value)
+{
+    char str[24];
+    auto result = std::to_chars(str, str + sizeof(str), value, 16);
+    return append(std::string_view(str, result.ptr - str));
+}
+
+int ProfileWriter::commit()
+{
+    if (fd < 0) {
+        return DFOT_ERROR;
+    }
+    flush();
+    if (!failed && fsync(fd) != 0) {
+        ERROR("[run] fsync " << tmp_path << " error: " << strerror(errno));
+        failed = true;
+    }
+    if (::close(fd) != 0) {
+        failed = true;
+    }
+    fd = -1;
+    if (failed || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        ERROR("[run] replace " << path << " error");
+        unlink(tmp_path.c_str());
+        return DFOT_ERROR;
+    }
+    return DFOT_OK;
+}
+
+void ProfileWriter::abort()
+{
+    if (fd < 0) {
+        return;
+    }
+    ::close(fd);
+    fd = -1;
+    unlink(tmp_path.c_str());
+    buffer.clear();
+}
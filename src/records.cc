@@ -1,13 +1,153 @@
+#include <algorithm>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+
 #include "logs.h"
 #include "utils.h"
 #include "records.h"
 // 记录插件enable之后的各项计数
 global_records records;
 
+Pidinfo *PidinfoPool::alloc()
+{
+    Pidinfo *info;
+    if (!free_list.empty()) {
+        info = free_list.back();
+        free_list.pop_back();
+    } else {
+        if (chunk_used == PIDINFO_CHUNK_SIZE) {
+            chunks.emplace_back(new Pidinfo[PIDINFO_CHUNK_SIZE]);
+            chunk_used = 0;
+        }
+        info = &chunks.back()[chunk_used++];
+    }
+    memset(info, 0, sizeof(Pidinfo));
+    return info;
+}
+
+void PidinfoPool::free(Pidinfo *info)
+{
+    free_list.push_back(info);
+}
+
+void PidinfoPool::clear()
+{
+    free_list.clear();
+    chunks.clear();
+    chunk_used = PIDINFO_CHUNK_SIZE;
+}
+
+void PidTable::init(size_t capacity)
+{
+    clear();
+    this->capacity = capacity;
+}
+
+Pidinfo *PidTable::insert(pid_t pid, int64_t now)
+{
+    if (table.size() >= capacity) {
+        // 先清理已退出的进程，全表清理需要逐个检查进程，按清理周期限频
+        if (now - last_full_sweep >= PID_SWEEP_PERIOD) {
+            last_full_sweep = now;
+            sweep(now, 0);
+        }
+        // 仍然不足时批量淘汰最久未出现的pid，之后的插入无需再遍历全表
+        if (table.size() >= capacity) {
+            evict_oldest(std::max<size_t>(1, capacity / PID_EVICT_RATIO));
+        }
+    }
+    Pidinfo *info = pool.alloc();
+    info->pid = pid;
+    info->ts = now;
+    table[(uint64_t)pid] = info;
+    return info;
+}
+
+void PidTable::erase(pid_t pid)
+{
+    Pidinfo *info = find(pid);
+    if (info == nullptr) {
+        return;
+    }
+    table.erase((uint64_t)pid);
+    pool.free(info);
+}
+
+void PidTable::clear()
+{
+    table.clear();
+    pool.clear();
+    last_full_sweep = 0;
+}
+
+// 进程已退出，或pid已被其他进程复用
+static bool is_pid_stale(const Pidinfo *info)
+{
+    if (kill(info->pid, 0) != 0 && errno == ESRCH) {
+        return true;
+    }
+    return info->starttime != 0 && get_process_start_time(info->pid) != info->starttime;
+}
+
+size_t PidTable::sweep(int64_t now, int64_t idle_time)
+{
+    std::vector<pid_t> stale;
+    table.for_each([&](uint64_t, Pidinfo *info) {
+        if (now - info->ts >= idle_time && is_pid_stale(info)) {
+            stale.push_back(info->pid);
+        }
+    });
+    for (pid_t pid : stale) {
+        erase(pid);
+    }
+    records.evicted_pids += stale.size();
+    return stale.size();
+}
+
+void PidTable::evict_oldest(size_t count)
+{
+    std::vector<Pidinfo *> infos;
+    infos.reserve(table.size());
+    table.for_each([&infos](uint64_t, Pidinfo *info) { infos.push_back(info); });
+    count = std::min(count, infos.size());
+    // 优先淘汰非目标应用的pid，同类按最近出现时间从旧到新
+    std::nth_element(infos.begin(), infos.begin() + count, infos.end(), [](const Pidinfo *a, const Pidinfo *b) {
+        if ((a->instance == nullptr) != (b->instance == nullptr)) {
+            return a->instance == nullptr;
+        }
+        return a->ts < b->ts;
+    });
+    for (size_t i = 0; i < count; ++i) {
+        erase(infos[i]->pid);
+    }
+    records.evicted_pids += count;
+}
+
+// FNV-1a hash，用于按内容索引模块路径
+uint64_t hash_module_path(const char *path)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char *p = (const unsigned char *)path; *p != '\0'; ++p) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    // 避开FlatMap的空槽位标记
+    return hash == FLAT_MAP_EMPTY_KEY ? hash - 1 : hash;
+}
+
 void reset_records()
 {
     records.processed_samples = 0;
-    records.pids.clear();
+    records.queued_batches = 0;
+    records.dropped_batches = 0;
+    records.dropped_samples = 0;
+    records.queue_depth = 0;
+    records.queue_depth_max = 0;
+    records.evicted_pids = 0;
+    records.reused_pids = 0;
+    records.last_pid_sweep = 0;
+    records.pids.init(configs != nullptr ? configs->collector_max_pids : DEFAULT_COLLECTOR_MAX_PIDS);
     records.modules.clear();
 }
 
@@ -15,19 +155,24 @@ void debug_print_records()
 {
     DEBUG("---------------------------------------------------------------");
     DEBUG("[DFOT_RECORD] processed_samples: " << records.processed_samples);
-    DEBUG("[DFOT_RECORD] total pids       : " << records.pids.size());
-    for (auto it = records.pids.begin(); it != records.pids.end(); ++it) {
-        int pid = it->first;
-        Pidinfo* info = it->second;
+    DEBUG("[DFOT_RECORD] queued_batches   : " << records.queued_batches);
+    DEBUG("[DFOT_RECORD] dropped_batches  : " << records.dropped_batches);
+    DEBUG("[DFOT_RECORD] dropped_samples  : " << records.dropped_samples);
+    DEBUG("[DFOT_RECORD] queue_depth      : " << records.queue_depth
+        << " (max: " << records.queue_depth_max << ")");
+    DEBUG("[DFOT_RECORD] cached modules   : " << records.modules.size());
+    DEBUG("[DFOT_RECORD] total pids       : " << records.pids.size()
+        << " (evicted: " << records.evicted_pids << ", reused: " << records.reused_pids << ")");
+    records.pids.for_each([](const Pidinfo *info) {
         // 过滤非目标应用的pid
         if (info->instance == nullptr || info->instance->app == nullptr) {
-            continue;
+            return;
         }
-        DEBUG("[DFOT_RECORD]   [" <<  info->instance->app->app_name << "] pid: " << pid
-            << ", starttime: " << turn_timestamp_to_format_time(info->ts)
+        DEBUG("[DFOT_RECORD]   [" <<  info->instance->app->app_name << "] pid: " << info->pid
+            << ", lastseen: " << turn_timestamp_to_format_time(info->ts)
             << ", instance version: " << info->instance->version
             << ", instance createtime: "
             << turn_timestamp_to_format_time(info->instance->id * 1000));
-    }
+    });
     DEBUG("[DFOT_RECORD] the others are not target app's pids");
 }
@@ -1,11 +1,15 @@
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <string>
+#include <fstream>
 #include <map>
 #include <set>
+#include <mutex>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <boost/filesystem.hpp>
 
@@ -15,6 +19,13 @@
 #include "utils.h"
 #include "configs.h"
 #include "records.h"
+#include "opt.h"
+#include "aggregator.h"
+#include "profile_writer.h"
+#include "profile_store.h"
+#include "checkpoint.h"
+#include "executor.h"
+#include "process_tracker.h"
 
 const std::string addrs_file = "/etc/dfot/addrs.txt";
 
@@ -22,7 +33,7 @@ const std::string addrs_file = "/etc/dfot/addrs.txt";
 bool check_dependence_ready()
 {
     // 检查sysboost服务是否启动
-    auto result = exec_cmd("systemctl is-active sysboost");
+    auto result = exec_cmd({"systemctl", "is-active", "sysboost"});
     if (result.cmd_log != "active\n") {
         ERROR("[enable] invalid sysboost status: " << result.cmd_log);
         return false;
@@ -31,13 +42,11 @@ bool check_dependence_ready()
     // 检查llvm-bolt、perf2bolt是否安装
     for (auto it = configs->apps.begin(); it != configs->apps.end(); ++it) {
         AppConfig *app = *it;
-        result = exec_cmd("ls -l " + app->bolt_dir + "/llvm-bolt > /dev/null 2>&1");
-        if (result.ret != 0) {
+        if (access((app->bolt_dir + "/llvm-bolt").c_str(), X_OK) != 0) {
             ERROR("[enable] " << app->bolt_dir << "/llvm-bolt is not installed");
             return false;
         }
-        result = exec_cmd("ls -l " + app->bolt_dir + "/perf2bolt > /dev/null 2>&1");
-        if (result.ret != 0) {
+        if (access((app->bolt_dir + "/perf2bolt").c_str(), X_OK) != 0) {
             ERROR("[enable] " << app->bolt_dir << "/perf2bolt is not installed");
             return false;
         }
@@ -48,10 +57,16 @@ bool check_dependence_ready()
 
 std::string get_app_profile(AppConfig *app)
 {
-    // 使用最新的采样数据进行优化
-    if (app->collected_profile != "" && boost::filesystem::exists(app->collected_profile)) {
-        DEBUG("[run] using the latest collected profile: " << app->collected_profile);
-        return app->collected_profile;
+    // 使用当前二进制最新保存的profile进行优化，保存的profile按二进制标识区分，二进制升级前采集的不会被使用
+    std::string identity = get_bin_identity(app->full_path);
+    if (identity != "") {
+        auto generations = profile_store_generations(configs->tuner_profile_dir, app->app_name, identity);
+        if (!generations.empty()) {
+            std::string path = profile_store_path(configs->tuner_profile_dir, app->app_name, identity,
+                generations.back());
+            DEBUG("[run] using the latest collected profile: " << path);
+            return path;
+        }
     }
     // 使用预置的采样数据进行优化
     if (app->default_profile != "" && boost::filesystem::exists(app->default_profile)) {
@@ -65,78 +80,117 @@ std::string get_app_profile(AppConfig *app)
 
 // 清空内存中的profile数据
 void clear_app_profile_data(AppConfig *app) {
-    app->profile.addrs.clear();
-    app->profile.funcs.clear();
-    app->profile.ts = 0;
+    profile_clear(app->profile);
+}
+
+// 按目标应用路径对模块分类，不属于任何目标应用时app为nullptr
+static ModuleInfo build_module_info(const char *module)
+{
+    ModuleInfo info{std::string(module), nullptr, false};
+    size_t matched = 0;
+    for (AppConfig *app : configs->apps) {
+        const std::string &path = app->full_path;
+        if (info.path == path) {
+            return ModuleInfo{info.path, app, false};
+        }
+        // 优化版本以原始二进制路径为前缀，存在多个匹配时取最长路径
+        if (info.path.find(".rto") != std::string::npos &&
+            info.path.compare(0, path.size(), path) == 0 && path.size() > matched) {
+            info.app = app;
+            info.optimized = true;
+            matched = path.size();
+        }
+    }
+    return info;
+}
+
+// 查询模块分类，结果按路径内容缓存，跨批次有效，出现新实例时失效
+const ModuleInfo &classify_module(const char *module)
+{
+    static const ModuleInfo unknown{"", nullptr, false};
+    if (module == nullptr) {
+        return unknown;
+    }
+
+    bool inserted = false;
+    ModuleInfo &info = records.modules.get_or_insert(hash_module_path(module), &inserted);
+    if (inserted) {
+        info = build_module_info(module);
+    } else if (info.path != module) {
+        // hash冲突，直接分类不缓存
+        static thread_local ModuleInfo collided;
+        collided = build_module_info(module);
+        return collided;
+    }
+    return info;
 }
 
-void update_app_profile_data(AppConfig *app, struct PmuData &data)
+// weight为该地址在批次内的采样数，聚合时已过滤非目标应用模块的采样
+void update_app_profile_data(BinaryInstance *instance, int64_t ts, const SampleBatch &batch,
+    const SampleSymbol &symbol, int weight)
 {
-    if (data.ts < app->profile.ts) {
+    AppConfig *app = instance->app;
+    if (ts < app->profile.ts) {
         // 场景1: 采样数据时间戳异常，大概率数据处理慢导致，直接丢弃
         DEBUG("[run] wrong timestamp of pmudata, data.ts: "
-            << data.ts << ", app.ts(already stored in memory): " << app->profile.ts);
+            << ts << ", app.ts(already stored in memory): " << app->profile.ts);
         return;
     } else if (app->profile.ts == 0) {
         // 场景2: 内存中没有profile数据，更新时间戳
-        app->profile.ts = data.ts;
-    } else if (data.ts - app->profile.ts > configs->collector_data_aging_time) {
+        app->profile.ts = ts;
+    } else if (app->window.mode == WINDOW_RESET &&
+        ts - app->profile.ts > configs->collector_data_aging_time) {
         // 场景3: 超过老化时间，丢弃历史数据
         clear_app_profile_data(app);
-        app->profile.ts = data.ts;
+        app->profile.ts = ts;
         DEBUG("[run] clear old profile data for " << app->app_name);
     }
+    // 分桶/衰减模式下按时间桶逐步老化历史数据
+    profile_advance_window(app->profile, app->window, ts);
 
-    // {内存地址addr: {函数名name, 偏移offset, 计数count}, ...}
+    // {内存地址addr: {函数ID sym, 偏移offset, 计数count}, ...}
     auto &addrs = app->profile.addrs;
-    // {函数名func: {内存地址addr: 计数count, ...}, ...}
+    // [函数ID sym]: {偏移offset: 计数count, ...}
     auto &funcs = app->profile.funcs;
 
-    // 刷新modules记录，避免直接匹配modules字符串，此处的module是relapath路径
-    auto symbol = data.stack->symbol;
-    if (records.modules.find(symbol->module) == records.modules.end()) {
-        records.modules[symbol->module] = false;
-        if (strcmp(symbol->module, app->full_path.c_str()) == 0) {
-            records.modules[symbol->module] = true;
-        } else if (strstr(symbol->module, ".rto") != nullptr &&
-            strncmp(symbol->module, app->full_path.c_str(), strlen(app->full_path.c_str())) == 0) {
-            records.modules[symbol->module] = true;
-        }
-    }
-
-    if (!records.modules[symbol->module]) {
-        return;
-    }
-
     // symbol->codeMapAddr symbol->offset
     // 如果是BOLT优化过后的二进制的采样数据则只需记录地址和计数
-    unsigned long addr = symbol->codeMapAddr;
-
-    if (records.pids[data.pid]->instance->version > 0) {
-        if (addrs.find(addr) != addrs.end()) {
-            addrs[addr].count++;
+    unsigned long addr = symbol.addr;
+    const char *name = sample_string(batch, symbol.name);
+    AddrInfo *info = addrs.find(addr);
+    profile_window_add(app->profile, app->window, addr, weight);
+
+    if (instance->version > 0) {
+        if (info != nullptr) {
+            info->count += weight;
         } else {
-            addrs[addr] = AddrInfo{std::string(""), 0, 1};
+            addrs[addr] = AddrInfo{INVALID_SYMBOL_ID, 0, weight, 0};
         }
         return;
     }
 
     // 原始二进制的采样数据，读取地址+符号+偏移
-    if (addrs.find(addr) != addrs.end()) {
-        addrs[addr].count++;
-        funcs[addrs[addr].name][symbol->offset]++;
-    } else {
-        addrs[addr] = AddrInfo();
-        if (symbol->mangleName != nullptr) {
-            addrs[addr].name = symbol->mangleName;
-        } else {
-            auto sym = SymResolverMapAddr(data.pid, addr);
-            addrs[addr].name = sym->mangleName;
+    if (info != nullptr) {
+        info->count += weight;
+        if (info->sym != UNRESOLVED_SYMBOL_ID) {
+            funcs[info->sym][symbol.offset] += weight;
+        } else if (name != nullptr) {
+            // 从检查点恢复或此前未给出符号的地址，首次拿到符号时补记函数，之前的计数一并计入
+            info->sym = profile_intern_func(app->profile, name);
+            info->offset = symbol.offset;
+            funcs[info->sym][symbol.offset] += info->count;
         }
-        addrs[addr].offset = symbol->offset;
-        addrs[addr].count = 1;
-        funcs[addrs[addr].name][symbol->offset] = 1;
+        return;
+    }
+
+    // libkperf未给出符号时不在采样路径上解析，只记录地址，导出时基于ELF符号索引批量解析
+    if (name == nullptr) {
+        addrs[addr] = AddrInfo{UNRESOLVED_SYMBOL_ID, 0, weight, 0};
+        return;
     }
+    uint32_t id = profile_intern_func(app->profile, name);
+    addrs[addr] = AddrInfo{id, symbol.offset, weight, 0};
+    funcs[id][symbol.offset] = weight;
 }
 
 // 获取profile中的函数数量，函数+偏移数量，以及有效sample数
@@ -147,19 +201,47 @@ void get_profile_func_offset_samples(const Profile &profile,
     *offsets = 0;
     *samples = 0;
 
-    for (const auto& [func_name, offset_map] : profile.funcs) {
+    for (const auto &offset_map : profile.funcs) {
         *offsets += offset_map.size();
-        for (const auto& [offset, count] : offset_map) {
+        offset_map.for_each([samples](uint64_t, int count) {
             *samples += count;
-        }
+        });
     }
 }
 
 // 判断是否需要将profile数据导出到文件
 bool need_flush_app_profile_to_file(AppConfig *app)
 {
-    // 当前仅根据地址数量判断
-    return app->profile.addrs.size() >= app->collector_dump_data_threshold;
+    // 地址数量达到阈值时直接导出
+    if (app->profile.addrs.size() >= app->collector_dump_data_threshold) {
+        return true;
+    }
+    const ProfileConvergence &conv = app->convergence;
+    ConvergenceState &state = app->profile.convergence;
+    int64_t now = get_current_timestamp();
+    if (!conv.enabled || now - state.last_check < conv.interval) {
+        return false;
+    }
+    state.last_check = now;
+
+    // 定期比较热点函数分布，连续多次稳定说明采样已能代表应用的热点
+    int64_t total = 0;
+    HotShares shares = profile_hot_shares(app->profile, conv.top_n, &total);
+    if (conv.max_samples > 0 && total >= conv.max_samples) {
+        INFO("[run] app [" << app->app_name << "] reached max samples: " << total);
+        return true;
+    }
+    double similarity = state.shares.empty() ? 0 : hot_shares_similarity(state.shares, shares);
+    state.shares = std::move(shares);
+    state.stable = (total >= conv.min_samples && similarity >= conv.similarity) ? state.stable + 1 : 0;
+    DEBUG("[run] app [" << app->app_name << "] samples: " << total
+        << ", hot set similarity: " << similarity << ", stable rounds: " << state.stable);
+    if (state.stable < conv.stable_rounds) {
+        return false;
+    }
+    INFO("[run] app [" << app->app_name << "] profile converged, samples: " << total
+        << ", similarity: " << similarity);
+    return true;
 }
 
 
@@ -167,78 +249,192 @@ bool need_flush_app_profile_to_file(AppConfig *app)
 int dump_app_addrs_to_file(AppConfig *app)
 {
     INFO("[run] dump addrs data to " << addrs_file);
-    FILE *fp = fopen(addrs_file.c_str(), "w");
-    if (fp == nullptr) {
-        ERROR("[run] fopen " << addrs_file << " error");
+    ProfileWriter writer;
+    if (writer.open(addrs_file) != DFOT_OK) {
         return DFOT_ERROR;
     }
 
     // 当前仅处理pmu_sampling_collector数据，性能事件固定为cycles
-    fprintf(fp, "cycles\n");
-    for (auto it = app->profile.addrs.begin(); it != app->profile.addrs.end(); ++it) {
-        fprintf(fp, "%lx %d\n", it->first, it->second.count);
+    writer.append("cycles\n");
+    auto &addrs = app->profile.addrs;
+    for (uint64_t addr : addrs.sorted_keys()) {
+        writer.append_hex(addr).append(' ').append_dec(addrs.find(addr)->count).append('\n');
+    }
+    return writer.commit();
+}
+
+// 优化相关外部命令（perf2bolt、sysboostd）的执行参数，优化任务执行器停止时终止运行中的命令
+static ExecOptions get_optimize_exec_options()
+{
+    ExecOptions options;
+    options.timeout = configs->tuner_optimizing_timeout * 1000;
+    options.nice = configs->tuner_optimizing_nice;
+    options.cpus = configs->tuner_optimizing_cpus;
+    options.cgroup = configs->tuner_optimizing_cgroup;
+    if (configs->tuner_optimizing_memory_limit > 0) {
+        options.rlimits.emplace_back(RLIMIT_DATA, (rlim_t)configs->tuner_optimizing_memory_limit << 20);
+    }
+    options.cancel = optimize_executor.cancel_flag();
+    return options;
+}
+
+// 解析perf2bolt输出的profile，第一行是固定内容"boltedcollection"，其余为"1 函数名 偏移 计数"
+static int load_perf2bolt_profile(const std::string &path, Profile &profile)
+{
+    std::ifstream file(path);
+    std::string line;
+    if (!file.is_open() || !std::getline(file, line) || line != "boltedcollection") {
+        return DFOT_ERROR;
+    }
+    while (std::getline(file, line)) {
+        if (line.compare(0, 6, "no_lbr") == 0) {
+            continue;
+        }
+        std::vector<char> name(line.size() + 1);
+        unsigned long offset = 0;
+        long long count = 0;
+        int type = 0;
+        if (sscanf(line.c_str(), "%d %s %lx %lld", &type, name.data(), &offset, &count) != 4 || count <= 0) {
+            return DFOT_ERROR;
+        }
+        profile.funcs[profile_intern_func(profile, name.data())][offset] += (int)count;
     }
-    fclose(fp);
     return DFOT_OK;
 }
 
-// 将地址数据转换成profile，并删除第一行
- int convert_addrs_to_profile(AppConfig *app)
- {
-    // 1. 使用perf2bolt转换地址数据为profile
-    std::string perf2bolt_cmd = app->bolt_dir + "/perf2bolt" + " -nl" +
-        " -p " + addrs_file + " --libkperf" +
-        " -o " + app->collected_profile +
-        " " + app->instances[app->instances.size() - 1]->full_path;
-    exec_result result = exec_cmd(perf2bolt_cmd);
+// 使用perf2bolt将地址数据转换为函数直方图，替换内存中的函数直方图
+int convert_addrs_to_profile(AppConfig *app)
+{
+    // 1. 使用perf2bolt转换地址数据为profile，输出到中间文件
+    std::string output = app->collected_profile + ".perf2bolt";
+    std::vector<std::string> perf2bolt_cmd = {app->bolt_dir + "/perf2bolt", "-nl",
+        "-p", addrs_file, "--libkperf", "-o", output, app->instances[app->instances.size() - 1]->full_path};
+    exec_result result = exec_cmd(perf2bolt_cmd, get_optimize_exec_options());
     if (result.ret != 0) {
-        ERROR("[run] exec " << perf2bolt_cmd << " error!"
+        ERROR("[run] exec " << format_cmd(perf2bolt_cmd) << " error!"
             "\nerror log: " << result.cmd_log);
+        std::remove(output.c_str());
         return DFOT_ERROR;
     }
 
-    // 2. 转换文件的第一行是固定内容"boltedcollection"，需要删除
-    std::ifstream inputFile(app->collected_profile);
-    if (!inputFile.is_open()) {
-        ERROR("[run] modified " << app->collected_profile << " error");
-        std::remove(app->collected_profile.c_str());
+    // 2. 逐行解析到独立的直方图，解析失败时内存中的数据保持不变
+    Profile converted;
+    int ret = load_perf2bolt_profile(output, converted);
+    std::remove(output.c_str());
+    if (ret != DFOT_OK) {
+        ERROR("[run] The content of " << output << " does not meet expectations.");
         return DFOT_ERROR;
     }
+    // deque移动不搬移元素，符号表索引中的string_view仍然有效
+    std::swap(app->profile.symbols, converted.symbols);
+    std::swap(app->profile.funcs, converted.funcs);
+    return DFOT_OK;
+}
 
-    std::string firstLine;
-    std::getline(inputFile, firstLine);
+// 批量解析采样时未解析符号的地址，并计入函数直方图
+void resolve_deferred_symbols(AppConfig *app)
+{
+    std::vector<uint64_t> pending;
+    app->profile.addrs.for_each([&pending](uint64_t addr, const AddrInfo &info) {
+        if (info.sym == UNRESOLVED_SYMBOL_ID) {
+            pending.push_back(addr);
+        }
+    });
+    if (pending.empty()) {
+        return;
+    }
 
-    if (firstLine == "boltedcollection") {
-        std::string remainingContent;
-        std::string line;
+    if (app->symbol_index.load(app->full_path, configs->tuner_profile_dir) != DFOT_OK) {
+        WARN("[run] no symbol index for " << app->full_path << ", "
+            << pending.size() << " unresolved addrs are skipped");
+        return;
+    }
 
-        // 读取剩余内容
-        while (std::getline(inputFile, line)) {
-            remainingContent += line + '\n';
+    size_t resolved = 0;
+    for (uint64_t addr : pending) {
+        uint64_t offset = 0;
+        const char *name = app->symbol_index.lookup(addr, &offset);
+        if (name == nullptr) {
+            continue;
         }
+        AddrInfo *info = app->profile.addrs.find(addr);
+        info->sym = profile_intern_func(app->profile, name);
+        info->offset = offset;
+        app->profile.funcs[info->sym][offset] += info->count;
+        resolved++;
+    }
+    DEBUG("[run] resolved " << resolved << "/" << pending.size() << " deferred addrs for "
+        << app->app_name);
+}
+
+// 通过优化后二进制的BAT，将采样地址转换为原始函数+偏移并计入函数直方图
+int resolve_bolted_symbols(AppConfig *app)
+{
+    const std::string &binary = app->instances[app->instances.size() - 1]->full_path;
+    if (app->bat.load(binary) != DFOT_OK ||
+        app->bolted_index.load(binary, configs->tuner_profile_dir) != DFOT_OK) {
+        return DFOT_ERROR;
+    }
 
-        inputFile.close();
+    std::vector<uint64_t> pending;
+    app->profile.addrs.for_each([&pending](uint64_t addr, const AddrInfo &info) {
+        if (info.sym == INVALID_SYMBOL_ID) {
+            pending.push_back(addr);
+        }
+    });
 
-        // 重新写入文件，覆盖原内容
-        std::ofstream outputFile(app->collected_profile);
-        if (!outputFile.is_open()) {
-            ERROR("[run] modified " << app->collected_profile << " error");
-            std::remove(app->collected_profile.c_str());
-            return DFOT_ERROR;
+    size_t resolved = 0;
+    for (uint64_t addr : pending) {
+        uint64_t offset = 0;
+        const char *name = app->bolted_index.lookup(addr, &offset);
+        if (name == nullptr) {
+            continue;
         }
-        outputFile << remainingContent;
-        outputFile.close();
-    } else {
-        ERROR("[run] The content of " << app->collected_profile << " does not meet expectations.");
-        std::remove(app->collected_profile.c_str());
-        return DFOT_ERROR;
+        // 冷片段的偏移同样以主函数的原始函数为基准，函数名取主函数
+        uint64_t func_addr = addr - offset;
+        uint64_t parent = app->bat.parent(func_addr);
+        uint64_t input_offset = app->bat.translate(func_addr, offset);
+        if (parent != func_addr) {
+            uint64_t parent_offset = 0;
+            name = app->bolted_index.lookup(parent, &parent_offset);
+            if (name == nullptr || parent_offset != 0) {
+                continue;
+            }
+        }
+        AddrInfo *info = app->profile.addrs.find(addr);
+        info->sym = profile_intern_func(app->profile, name);
+        info->offset = input_offset;
+        app->profile.funcs[info->sym][input_offset] += info->count;
+        resolved++;
+    }
+    DEBUG("[run] translated " << resolved << "/" << pending.size() << " bolted addrs for "
+        << app->app_name);
+    // 二进制无符号表等场景无法转换，交由perf2bolt处理
+    return (resolved == 0 && !pending.empty()) ? DFOT_ERROR : DFOT_OK;
+}
+
+// 累积模式下将上一轮（已含更早轮次）的profile按权重合入本轮数据
+void merge_app_profile_history(AppConfig *app, const std::string &identity)
+{
+    auto generations = profile_store_generations(configs->tuner_profile_dir, app->app_name, identity);
+    if (generations.empty()) {
+        return;
     }
-    return DFOT_OK;
+    StoredProfile stored;
+    std::string path = profile_store_path(configs->tuner_profile_dir, app->app_name, identity, generations.back());
+    if (stored.load(path) != DFOT_OK) {
+        WARN("[run] load profile history " << path << " failed, dump current round only");
+        return;
+    }
+    profile_merge_stored(app->profile, stored, app->cumulative_weight);
+    INFO("- History : merged generation " << generations.back() << " with weight " << app->cumulative_weight);
 }
 
 // 将profile数据导出到文件
 void dump_app_profile_to_file(AppConfig *app)
 {
+    std::lock_guard<std::mutex> lock(app->profile_mtx);
+
     if (configs->tuner_optimizing_strategy == OPTIMIZE_ONE_TIME
         && app->status == OPTIMIZED) {
         clear_app_profile_data(app);
@@ -247,47 +443,54 @@ void dump_app_profile_to_file(AppConfig *app)
 
     INFO("[run] app [" << app->app_name << "] is dumping new profile...");
     INFO("profile info:");
-    INFO("- Location: " << app->collected_profile);
     auto seconds = (get_current_timestamp() - app->profile.ts) / 1000;
     INFO("- Time    : " << seconds << "s"
         << " [" << turn_timestamp_to_format_time(app->profile.ts)
         << " - " << turn_timestamp_to_format_time(get_current_timestamp()) << "]");
     INFO("- Count   : " << app->profile.addrs.size());
-    
-    std::lock_guard<std::mutex> lock(app->profile_mtx);
+    int64_t dump_begin = get_current_timestamp();
+    std::string identity = get_bin_identity(app->full_path);
+    if (identity == "") {
+        ERROR("[run] get identity of " << app->full_path << " failed.");
+        return;
+    }
+
+    // DEBUG模式下导出地址用于后续分析
+    if (configs->log_level == log4cplus::DEBUG_LOG_LEVEL && dump_app_addrs_to_file(app) != DFOT_OK) {
+        ERROR("[run] dump addrs data to file error.");
+        return;
+    }
 
-    // 二进制已经优化过，导出地址数据并通过perf2bolt转换生成profile
     if (app->instances.size() > 1) {
-        if (dump_app_addrs_to_file(app) != DFOT_OK) {
-            ERROR("[run] dump addrs data to file error.");
-            return;
-        }
-        if (convert_addrs_to_profile(app) != DFOT_OK) {
-            ERROR("[run] convert addrs to profile error.");
-            return;
+        // 二进制已经优化过，优先通过BAT直接转换，BAT不可用时导出地址数据并通过perf2bolt转换
+        if (resolve_bolted_symbols(app) != DFOT_OK) {
+            WARN("[run] translate addrs by BAT failed, fallback to perf2bolt");
+            if (configs->log_level != log4cplus::DEBUG_LOG_LEVEL && dump_app_addrs_to_file(app) != DFOT_OK) {
+                ERROR("[run] dump addrs data to file error.");
+                return;
+            }
+            if (convert_addrs_to_profile(app) != DFOT_OK) {
+                ERROR("[run] convert addrs to profile error.");
+                return;
+            }
         }
     } else {
-        // DEBUG模式下导出地址用于后续分析
-        if (configs->log_level == log4cplus::DEBUG_LOG_LEVEL && dump_app_addrs_to_file(app) != DFOT_OK) {
-            ERROR("[run] dump addrs data to file error.");
-            return;
-        }
+        // 二进制未优化过，先批量解析符号
+        resolve_deferred_symbols(app);
+    }
+    if (app->cumulative_weight > 0) {
+        merge_app_profile_history(app, identity);
+    }
 
-        // 二进制未优化过，导出profile数据
-        FILE *fp = fopen(app->collected_profile.c_str(), "w");
-        if (fp == nullptr) {
-            ERROR("[run] fopen " << app->collected_profile << " error");
-            return;
-        }
-        // 当前仅处理pmu_sampling_collector数据，性能事件固定为cycles
-        fprintf(fp, "no_lbr cycles:\n");
-        for (auto it1 = app->profile.funcs.begin(); it1 != app->profile.funcs.end(); ++it1) {
-            for (auto it2 = it1->second.begin(); it2 != it1->second.end(); ++it2) {
-                fprintf(fp, "1 %s %lx %d\n", it1->first.c_str(), it2->first, it2->second);
-            }
-        }
-        fclose(fp);
+    // profile只以二进制格式按版本保存，优化任务执行时再由保存的版本生成BOLT profile和热点函数列表
+    if (profile_store_save(app->profile, configs->tuner_profile_dir, app->app_name,
+        identity, configs->tuner_profile_history, get_current_timestamp()) != DFOT_OK) {
+        ERROR("[run] save profile of " << app->app_name << " failed.");
+        // 函数直方图可能已被perf2bolt的转换结果替换，不能继续累加采样
+        clear_app_profile_data(app);
+        return;
     }
+    INFO("- Dump    : " << get_current_timestamp() - dump_begin << "ms");
 
     // 更新app状态
     if ((configs->tuner_optimizing_strategy == OPTIMIZE_ONE_TIME
@@ -299,20 +502,54 @@ void dump_app_profile_to_file(AppConfig *app)
     clear_app_profile_data(app);
 }
 
+// 二进制原地升级后，旧版本的实例、采样数据和优化状态均已失效，重置app后按新二进制重新采样
+static void reset_app_for_upgrade(AppConfig *app, const std::string &build_id)
+{
+    INFO("[run] binary of app [" << app->app_name << "] is upgraded, build-id: "
+        << app->build_id << " -> " << build_id);
+    // 旧实例的进程记录随实例一起删除，仍在运行的旧进程重新识别
+    std::vector<pid_t> stale_pids;
+    records.pids.for_each([app, &stale_pids](const Pidinfo *info) {
+        if (info->instance != nullptr && info->instance->app == app) {
+            stale_pids.push_back(info->pid);
+        }
+    });
+    for (pid_t stale : stale_pids) {
+        records.pids.erase(stale);
+    }
+    for (BinaryInstance *instance : app->instances) {
+        delete instance;
+    }
+    app->instances.clear();
+    app->build_id = build_id;
+    app->status = app->default_profile != "" ? NEED_OPTIMIZED : UNOPTIMIZED;
+    clear_app_profile_data(app);
+    records.modules.clear();
+}
+
+// 进程的buildid与已有实例不一致且与磁盘上的当前二进制一致，说明二进制已原地升级
+// buildid未知（读取失败或二进制没有buildid）时不判定为升级，新旧进程并存时旧进程不会触发重置
+static bool is_app_upgraded(AppConfig *app, const std::string &build_id)
+{
+    if (build_id == "" || app->instances.size() == 0 || app->instances[0]->build_id == "" ||
+        app->instances[0]->build_id == build_id) {
+        return false;
+    }
+    return get_bin_build_id(app->full_path) == build_id;
+}
+
 // 根据pid获取对应的binaryinstance
 BinaryInstance *find_or_create_binary_instance(AppConfig *app, pid_t pid)
 {
-    bool is_optimized = false;
     std::string full_path = get_bin_full_path_by_pid(pid);
 
-    // 判断app是否是优化版本
-    const std::string suffix = ".rto";
-    if (full_path.size() > suffix.size() &&
-        full_path.compare(full_path.size() - suffix.size(), suffix.size(), suffix) == 0) {
-        is_optimized = true;
-    }
+    // 判断app是否是优化版本，与采样模块使用同一份分类结果
+    const ModuleInfo &module = classify_module(full_path.c_str());
+    bool is_optimized = module.app == app && module.optimized;
 
     time_t ctime = get_file_create_time(full_path);
+    // 通过/proc/<pid>/exe读取进程实际运行的二进制，原地升级后旧进程的链接路径带" (deleted)"，无法按路径读取
+    std::string build_id = get_bin_build_id("/proc/" + std::to_string(pid) + "/exe");
 
     // 非优化版本，不能存在优化版本采样数据
     // 1. 正常场景：无采样数据和实例 -- 创建新实例
@@ -320,8 +557,19 @@ BinaryInstance *find_or_create_binary_instance(AppConfig *app, pid_t pid)
     // 3. 异常场景：有优化实例但当前采样数据指向的是非优化版本 -- 异常场景
     // 4. 异常场景：有多个实例但当前采样数据指向的是非优化版本 -- 异常场景
     if (!is_optimized) {
+        // 二进制已原地升级时旧实例和采样数据全部作废，升级前仍在运行的旧进程不计入
+        if (is_app_upgraded(app, build_id)) {
+            reset_app_for_upgrade(app, build_id);
+        } else if (build_id != "" && app->instances.size() > 0 && app->instances[0]->build_id != "" &&
+            app->instances[0]->build_id != build_id) {
+            WARN("[run] process " << pid << " of app [" << app->app_name << "] runs stale build-id " << build_id);
+            return nullptr;
+        } else if (build_id != "" && app->instances.size() == 0 && app->build_id != build_id) {
+            app->build_id = build_id;
+        }
         if (app->instances.size() == 0 && app->profile.addrs.size() == 0) {
-            app->instances.push_back(new BinaryInstance{app, 0, full_path, ctime});
+            app->instances.push_back(new BinaryInstance{app, 0, full_path, ctime, build_id});
+            records.modules.clear();
         } else if (app->instances.size() == 0 && app->profile.addrs.size() != 0) {
             ERROR("[run] found data remnants for app: " << app->app_name);
             clear_app_profile_data(app);
@@ -340,6 +588,12 @@ BinaryInstance *find_or_create_binary_instance(AppConfig *app, pid_t pid)
     // 优化版本
     // 1. 正常场景：有实例且实例id与当前二进制创建时间一致 -- 返回实例
     // 2. 正常场景：无实例 -- 创建新实例
+    // 3. 异常场景：优化版本与原始二进制的buildid不一致，说明是升级前遗留的优化版本 -- 异常场景
+    if (build_id != "" && app->build_id != "" && build_id != app->build_id) {
+        ERROR("[run] stale optimized binary " << full_path << " for app: " << app->app_name
+            << ", build-id " << build_id << " does not match " << app->build_id);
+        return nullptr;
+    }
     if (app->instances.size() > 0
         && app->instances[app->instances.size() - 1]->id == ctime) {
         return app->instances[app->instances.size() - 1];
@@ -347,52 +601,78 @@ BinaryInstance *find_or_create_binary_instance(AppConfig *app, pid_t pid)
         // 直接通过预置profile优化的场景，补充一个未优化实例，方便使用no判断优化
         char rlpath[1024] = {0};
         get_real_path(app->full_path.c_str(), rlpath);
-        app->instances.push_back(new BinaryInstance{app, 0, std::string(rlpath), 0});
+        app->instances.push_back(new BinaryInstance{app, 0, std::string(rlpath), 0, app->build_id});
     }
 
     clear_app_profile_data(app);
     app->instances.push_back(new BinaryInstance{
-        app, (unsigned int)app->instances.size(), full_path, ctime});
+        app, (unsigned int)app->instances.size(), full_path, ctime, build_id});
+    // 出现新实例，模块分类可能变化，清空模块缓存
+    records.modules.clear();
     return app->instances[app->instances.size() - 1];
 }
 
-// 获取采样数据对应的app，并创建对应的binaryinstance等数据缓存
-// 区分目标应用/目标应用优化版本/非目标应用
-AppConfig *get_app_and_build_data_cache(struct PmuData *data)
+// 切换当前持有的profile锁到指定app，连续处理同一app的采样数据时无需重复加锁
+static void switch_app_lock(std::unique_lock<std::mutex> &lock, AppConfig *app)
+{
+    if (lock.owns_lock() && lock.mutex() == &app->profile_mtx) {
+        return;
+    }
+    if (lock.owns_lock()) {
+        lock.unlock();
+    }
+    lock = std::unique_lock<std::mutex>(app->profile_mtx);
+}
+
+// 获取采样数据对应的实例，并创建对应的binaryinstance等数据缓存
+// 区分目标应用/目标应用优化版本/非目标应用，非目标应用返回nullptr
+// 创建binaryinstance会修改app数据，需要持有对应app的profile锁
+BinaryInstance *get_instance_and_build_data_cache(const SampleProc *data, int64_t ts,
+    std::unique_lock<std::mutex> &lock)
 {
     // 如果该数据对应的pid已经记录过，则无需再判断二进制信息
     // 根据instance判断是否是目标应用
-    if (records.pids.find(data->pid) != records.pids.end()) {
-        records.pids[data->pid]->ts = data->ts;
-        if (records.pids[data->pid]->instance == nullptr) { // 非目标应用，返回空app
+    Pidinfo *info = records.pids.find(data->pid);
+    if (info != nullptr) {
+        if (strncmp(info->comm, data->comm, SAMPLE_COMM_LEN) == 0) {
+            info->ts = ts;
+            return info->instance;
+        }
+        // 进程名变化，说明pid已被新进程复用，重新识别
+        records.reused_pids++;
+        records.pids.erase(data->pid);
+    }
+
+    BinaryInstance *bi = nullptr;
+    AppConfig *app = match_app(data->comm, data->pid);
+    if (app != nullptr) {
+        switch_app_lock(lock, app);
+        bi = find_or_create_binary_instance(app, data->pid);
+        if (bi == nullptr) {
+            ERROR("[run] find or create binary instance for [" << app->app_name << "] failed");
             return nullptr;
         }
-        return records.pids[data->pid]->instance->app; // 目标应用，返回对应app，用于记录profile信息
     }
 
-    unsigned int index = 0;
-    for (; index < configs->apps.size(); ++index) {
-        if (strcmp(configs->apps[index]->app_name.c_str(), data->comm) == 0) {
-            break;
-        }
-    }
-    // 非目标应用，创建空pidinfo
-    if (index == configs->apps.size()) {
-        records.pids[data->pid] = new Pidinfo{nullptr, data->pid, data->ts};
-        return nullptr;
+    // 非目标应用创建空instance的pidinfo
+    info = records.pids.insert(data->pid, ts);
+    info->instance = bi;
+    memcpy(info->comm, data->comm, SAMPLE_COMM_LEN);
+    if (bi != nullptr) {
+        info->starttime = get_process_start_time(data->pid);
     }
+    return bi;
+}
 
-    BinaryInstance *bi = find_or_create_binary_instance(configs->apps[index], data->pid);
-    if (bi == nullptr) {
-        ERROR("[run] find or create binary instance for [" << configs->apps[index]->app_name << "] failed");
-        return nullptr;
-    }
-    records.pids[data->pid] = new Pidinfo{bi, data->pid, data->ts};
-    return configs->apps[index];
+// 应用在配置中的编号，用于聚合线程按编号比较模块和进程的归属
+static uint32_t get_app_index(AppConfig *app)
+{
+    auto it = std::find(configs->apps.begin(), configs->apps.end(), app);
+    return (uint32_t)(it - configs->apps.begin());
 }
 
-// 处理pmu采样数据
-void process_pmudata(struct PmuData *data, int len)
+// 处理pmu采样数据，入队时已过滤空数据和内核地址
+void process_pmudata(const SampleBatch &batch)
 {
     // 1. 根据data中的pid判断app
     // 2. 判断现存数据的ts，如果ts在老化时间阈值前，则丢弃历史数据，并处理当前数据，刷新ts；如果ts未到阈值则处理当前数据
@@ -402,69 +682,122 @@ void process_pmudata(struct PmuData *data, int len)
     //     最早一条profile数据的timestamp
     //     int64_t ts;
     //     地址信息，减少符号解析过程
-    //     std::map<unsigned long, AddrInfo> addrs;
-    //       {<addr>: {<name>,<offset>,<count>}, ...}
+    //     FlatMap<AddrInfo> addrs;
+    //       {<addr>: {<sym>,<offset>,<count>}, ...}
+    //     函数名驻留表，函数名只保存一份，通过ID引用
+    //     SymbolTable symbols;
     //     函数信息，编译统计和导出
-    //     std::map<std::string, std::map<unsigned long, int>> funcs;
-    //       {<name>: {<offset>: <count>, ...}, ...}
+    //     std::vector<FlatMap<int>> funcs;
+    //       [<sym>]: {<offset>: <count>, ...}
     // }
 
     std::set<AppConfig*> updated_apps;
-
-    for (int i = 0; i < len; ++i) {
-        AppConfig *app = get_app_and_build_data_cache(&data[i]);
-
-        if (app == nullptr ||                   // 未匹配到app，直接跳过
-            data[i].stack == nullptr ||         // 空数据，直接跳过
-            data[i].stack->symbol == nullptr) { // 空数据，直接跳过
-            continue;
+    // 采样数据由聚合线程处理，与tuner线程的优化流程通过app的profile锁互斥
+    std::unique_lock<std::mutex> lock;
+
+    // 定期清理已退出进程的pid记录，避免pid表无限增长
+    int64_t now = get_current_timestamp();
+    if (now - records.last_pid_sweep >= PID_SWEEP_PERIOD) {
+        records.pids.sweep(now, PID_IDLE_TIME);
+        records.last_pid_sweep = now;
+    }
+
+    // 按批次内的进程和模块（而不是逐条采样）串行解析归属，创建实例会修改app数据
+    SampleOwners owners;
+    std::vector<BinaryInstance *> targets;
+    for (const SampleProc &proc : batch.procs) {
+        get_instance_and_build_data_cache(&proc, proc.ts, lock);
+    }
+    // 二进制升级会重置app并删除其旧实例，全部解析完成后再从pid表读取实例，不使用中途失效的指针
+    for (const SampleProc &proc : batch.procs) {
+        Pidinfo *info = records.pids.find(proc.pid);
+        BinaryInstance *instance = info != nullptr ? info->instance : nullptr;
+        uint32_t target = AGGREGATION_NO_OWNER;
+        if (instance != nullptr) {
+            auto it = std::find(targets.begin(), targets.end(), instance);
+            target = (uint32_t)(it - targets.begin());
+            if (it == targets.end()) {
+                targets.push_back(instance);
+                owners.target_apps.push_back(get_app_index(instance->app));
+            }
         }
-
-        // 过滤内核地址
-        if (data[i].stack->symbol->addr >= 0xffff000000000000) {
-            continue;
+        owners.proc_targets.push_back(target);
+    }
+    if (targets.empty()) {
+        return;
+    }
+    for (uint32_t module : batch.modules) {
+        AppConfig *app = classify_module(sample_string(batch, module)).app;
+        owners.module_apps.push_back(app != nullptr ? get_app_index(app) : AGGREGATION_NO_OWNER);
+    }
+
+    // 分片并行过滤和合并同地址采样，再按目标实例、分片顺序串行合入app profile，结果与线程调度无关
+    // 合并后的采样以该地址第一条采样的时间戳参与老化判断
+    size_t shards = sharded_aggregator.aggregate(batch, owners);
+    for (size_t target = 0; target < targets.size(); ++target) {
+        BinaryInstance *instance = targets[target];
+        switch_app_lock(lock, instance->app);
+        bool updated = false;
+        for (size_t shard = 0; shard < shards; ++shard) {
+            for (const AddrEntry &entry : sharded_aggregator.partial(shard).targets[target].entries) {
+                update_app_profile_data(instance, entry.ts, batch, batch.symbols[entry.symbol], entry.count);
+                updated = true;
+            }
         }
-
-        update_app_profile_data(app, data[i]);
-        updated_apps.insert(app);
+        if (updated) {
+            updated_apps.insert(instance->app);
+        }
+    }
+    if (lock.owns_lock()) {
+        lock.unlock();
     }
 
     for (AppConfig* app : updated_apps) {
-        DEBUG("[update] collected addrs for [" << app->app_name
-            << ": " << app->instances.size() - 1 << "]: "
-            << app->profile.addrs.size());
+        {
+            std::lock_guard<std::mutex> guard(app->profile_mtx);
+            DEBUG("[update] collected addrs for [" << app->app_name
+                << ": " << app->instances.size() - 1 << "]: "
+                << app->profile.addrs.size());
+
+            // 周期性写检查点，profile被清空后尽快重写，避免恢复已导出的数据
+            if (configs->collector_checkpoint_period > 0 &&
+                (now - app->last_checkpoint >= configs->collector_checkpoint_period ||
+                (app->profile.ckpt_reset && app->instances.size() == 1))) {
+                checkpoint_app_profile(app);
+            }
 
-        // 导出bolt profile（函数名+偏移+计数）
-        if (!need_flush_app_profile_to_file(app)) {
-            continue;
+            // 导出bolt profile（函数名+偏移+计数）
+            if (!need_flush_app_profile_to_file(app)) {
+                continue;
+            }
         }
         dump_app_profile_to_file(app);
     }
 }
 
-// 调用sysboostd进行优化
-void do_optimize(AppConfig *app, std::string profile)
+// 调用sysboostd进行优化，在优化任务线程中执行，仅在更新应用状态时持锁
+bool do_optimize(AppConfig *app, const std::string &profile)
 {
     const std::string required_bolt_options = "--enable-bat";
     const std::string debug_bolt_options    = "-update-debug-sections";
-    const std::string default_bolt_options  =
-        "-reorder-blocks=ext-tsp -reorder-functions=hfsort+ "
-        "-split-functions -split-all-cold -icf=1 "
-        "-use-gnu-stack --inline-all";
 
     INFO("[run] try to optimize app [" << app->app_name << "] "
         "with profile [" << profile << "]");
 
-    // 构造并执行sysboost优化回退命令（无论是否优化过）
-    auto result = exec_cmd("sysboostd --stop=" + app->full_path);
-    if (result.ret != 0) {
-        ERROR("[run] cleanup last optimization for [" << app->app_name << "] failed!");
-        return;
-    }
-
-    // 构造并执行sysboost优化使能命令
     std::string bolt_options =
-        app->bolt_options == "" ? default_bolt_options : app->bolt_options;
+        app->bolt_options == "" ? DEFAULT_BOLT_OPTIONS : app->bolt_options;
+    // 自动调优时由调优状态选择本轮使用的候选选项
+    int candidate = -1;
+    if (app->autotune.enabled) {
+        std::lock_guard<std::mutex> lock(app->profile_mtx);
+        candidate = autotune_select(app->autotune);
+        if (candidate < 0) {
+            WARN("[run] all autotune candidates of app [" << app->app_name << "] regressed, skip optimizing");
+            return false;
+        }
+        bolt_options = app->autotune.candidates[candidate].options;
+        INFO("[run] autotune candidate " << candidate << " of app [" << app->app_name << "]: " << bolt_options);
+    }
     if (bolt_options.find(required_bolt_options) == std::string::npos) {
         bolt_options += " " + required_bolt_options;
     }
@@ -472,53 +805,55 @@ void do_optimize(AppConfig *app, std::string profile)
         bolt_options += " " + debug_bolt_options;
     }
 
-    std::string opt_cmd = std::string("sysboostd") +
-        " --gen-bolt=" + app->full_path +
-        " --bolt-option=\"" + bolt_options + "\"" +
-        " --profile-path=" + profile;
+    // 热点函数模式：只处理profile附带的热点函数列表中的函数，冷代码保持不变
+    std::string funcs_file = profile + HOT_FUNCS_SUFFIX;
+    bool hot_only = app->hot_coverage > 0 && access(funcs_file.c_str(), F_OK) == 0 &&
+        bolt_options.find("-funcs-file") == std::string::npos;
+    if (hot_only) {
+        if (bolt_options.find("-lite") == std::string::npos) {
+            bolt_options += " -lite=1";
+        }
+        bolt_options += " -funcs-file=" + funcs_file;
+    }
 
-    uint64_t start_ts = get_current_timestamp();
-    result = exec_cmd(opt_cmd);
-    uint64_t end_ts = get_current_timestamp();
+    // 构造并执行sysboost优化回退命令（无论是否优化过）
+    auto result = exec_cmd({"sysboostd", "--stop=" + app->full_path});
     if (result.ret != 0) {
-        ERROR("[run] optimizing failed, please check the sysboost log");
+        ERROR("[run] cleanup last optimization for [" << app->app_name << "] failed!");
+        return false;
+    }
+
+    // 构造并执行sysboost优化使能命令，参数直接传递，不经过shell
+    std::vector<std::string> opt_cmd = {"sysboostd", "--gen-bolt=" + app->full_path,
+        "--bolt-option=" + bolt_options, "--profile-path=" + profile};
+    result = exec_cmd(opt_cmd, get_optimize_exec_options());
+    bool ok = result.ret == 0;
+    if (!ok) {
+        ERROR("[run] optimizing failed (exit code " << result.ret
+            << (result.timed_out ? ", timeout" : "") << (result.cancelled ? ", cancelled" : "")
+            << "), please check the sysboost log");
     } else {
-        DEBUG("[run] optimizing finished, cost: " << (end_ts - start_ts)/1000 << " s");
-        app->status = OPTIMIZED;
+        INFO("[run] optimizing [" << app->app_name << "] finished, cost: " << result.elapsed
+            << " ms, peak rss: " << result.max_rss / 1024 << " MB"
+            << (hot_only ? ", hot functions only" : ""));
     }
 
+    std::lock_guard<std::mutex> lock(app->profile_mtx);
+    if (ok) {
+        app->status = OPTIMIZED;
+        app->validation.optimized_rounds++;
+        // 验证结果计入本轮使用的候选选项
+        app->autotune.active = candidate;
+    }
     // 优化后需要清除当前profile数据，避免拉起优化二进制前后的数据混合
     clear_app_profile_data(app);
+    return ok;
 }
 
-// full_path为空时，如果有多个同名进程，返回获取到的第一个pid
-// full_path不为空，则获取到pid后需要校验路径
+// 由进程跟踪器直接查询，不创建子进程；有多个进程时返回其中任一pid
 int get_target_pid (AppConfig *app)
 {
-    char buffer[1024] = {0};
-    std::string command = "pidof " + app->app_name;
-    std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(command.c_str(), "r"), pclose);
-    if (!pipe) {
-        WARN("get " << app->app_name << "'s pid failed!");
-        return -1;
-    }
-    
-    // 获取每一个pid进行判断
-    while (fgets(buffer, sizeof(buffer), pipe.get()) != nullptr) {
-        int pid = atoi(buffer);
-        std::string proc_path = "/proc/" + std::to_string(pid) + "/exe";
-        if (!get_real_path(proc_path.c_str(), buffer)) {
-            WARN("get realpath of pid:" << pid << " failed!");
-            continue;
-        }
-
-        for (unsigned int index = 0; index < app->instances.size(); ++index) {
-            if (std::string(buffer) == app->instances[index]->full_path) {
-                return pid;
-            }
-        }
-    }
-    return -1;
+    return process_tracker.find(app);
 }
 
 // 判断应用是否满足优化条件
@@ -527,15 +862,20 @@ bool is_app_eligible_for_optimization(AppConfig *app)
     if (app->status != NEED_OPTIMIZED) {
         return false;
     }
-
-    if (configs->tuner_optimizing_condition == 0) {
-        if (get_target_pid(app) > 0) {
-            return false;
-        }
-        return true;
+    // 全部自动调优候选都使性能下降，继续优化只会反复回退
+    if (app->autotune.enabled && app->autotune.exhausted) {
+        return false;
     }
 
-    return false;
+    // 0: 应用退出；1: 整机低负载；2: 应用退出且整机低负载
+    int condition = configs->tuner_optimizing_condition;
+    if ((condition == 1 || condition == 2) && !load_monitor.low_load(get_current_timestamp())) {
+        return false;
+    }
+    if ((condition == 0 || condition == 2) && get_target_pid(app) > 0) {
+        return false;
+    }
+    return condition >= 0 && condition <= 2;
 }
 
 std::vector<int> update_pid_in_configs()
@@ -555,11 +895,60 @@ std::vector<int> update_pid_in_configs()
     return pids;
 }
 
+// 采样策略1：更新各应用进程的CPU使用率，返回是否有应用处于高负载
+// sampling为true表示当前正在采样，此时阈值下调迟滞值，避免在阈值附近频繁启停采样
+bool update_app_cpu_usage(bool sampling)
+{
+    int64_t now = get_current_timestamp();
+    long ticks = sysconf(_SC_CLK_TCK);
+    double threshold = configs->high_load_threshold - (sampling ? configs->high_load_hysteresis : 0);
+    bool high_load = false;
+
+    update_pid_in_configs();
+    for (AppConfig *app : configs->apps) {
+        // 多进程应用（如nginx worker）的负载分散在各进程上，累加应用全部进程的CPU时间增量
+        std::unordered_map<pid_t, uint64_t> cpu_times;
+        uint64_t delta = 0;
+        for (pid_t pid : process_tracker.pids(app)) {
+            uint64_t cpu_time = get_process_cpu_time(pid);
+            // 进程已退出或尚未占用CPU时间
+            if (cpu_time == 0) {
+                continue;
+            }
+            cpu_times[pid] = cpu_time;
+            // 新出现的进程以本次统计为基准，下一周期开始计入
+            auto last = app->cpu_times.find(pid);
+            if (last != app->cpu_times.end() && cpu_time >= last->second) {
+                delta += cpu_time - last->second;
+            }
+        }
+        if (app->cpu_ts > 0 && now > app->cpu_ts && ticks > 0) {
+            app->cpu_usage = 100.0 * delta / ticks * 1000 / (now - app->cpu_ts);
+        } else {
+            app->cpu_usage = 0;
+        }
+        app->cpu_times.swap(cpu_times);
+        app->cpu_ts = now;
+        DEBUG("[run] cpu usage of [" << app->app_name << "] " << app->cpu_times.size() << " processes: "
+            << app->cpu_usage << "%");
+        if (app->cpu_usage > threshold) {
+            high_load = true;
+        }
+    }
+    return high_load;
+}
+
 // 用于手动调试时打印内部数据
 __attribute__((used)) void debug_print_inner_data()
 {
     debug_print_configs();
     debug_print_records();
+    optimize_executor.debug_print();
+    process_tracker.debug_print();
+    load_monitor.debug_print(get_current_timestamp());
+    for (AppConfig *app : configs->apps) {
+        debug_print_validation(app);
+    }
     DEBUG("---------------------------------------------------------------");
 }
 
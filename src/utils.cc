@@ -3,24 +3,18 @@
 #include <limits.h>
 #include <iomanip>
 #include <functional>
+#include <fstream>
+#include <sstream>
 #include <boost/filesystem.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
 
 #include "utils.h"
 
-// 获取二进制buildid信息，预留接口
+// 获取二进制buildid信息（十六进制），没有build-id时返回空串
 std::string get_bin_build_id(std::string full_path)
 {
-    (void)full_path;
-    return "Not implemented";
-}
-
-// 获取二进制hash值，预留接口
-std::string get_exec_hash(std::string full_path)
-{
-    (void)full_path;
-    return "Not implemented";
+    return read_elf_build_id(full_path);
 }
 
 bool get_real_path(const char* path, char* resolved)
@@ -32,26 +26,6 @@ bool get_real_path(const char* path, char* resolved)
     return true;
 }
 
-exec_result exec_cmd(std::string cmd)
-{
-    std::string log;
-    int ret;
-    DEBUG("exec cmd: \"" << cmd << "\"");
-    FILE* pipe = popen(cmd.c_str(), "r");
-    if (!pipe) {
-        ERROR("popen failed");
-        return {"", -1};
-    }
-
-    char buffer[256];
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        log += buffer;
-    }
-
-    ret = pclose(pipe);
-    return {log, ret};
-}
-
 // 获取文件的创建时间（秒时间戳）
 time_t get_file_create_time(std::string file_path)
 {
@@ -93,4 +67,43 @@ std::string get_bin_full_path_by_pid(pid_t pid)
     
     buffer[len] = '\0';
     return std::string(buffer.data());
-}
\ No newline at end of file
+}
+
+// 读取/proc/<pid>/stat的第first到last项（从1开始计数），first不小于3
+static bool get_proc_stat_fields(pid_t pid, int first, int last, std::vector<uint64_t> &values)
+{
+    std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string stat;
+    std::getline(file, stat);
+    // 进程名可能包含空格，从最后一个')'之后开始解析，第一项为state（第3项）
+    size_t pos = stat.rfind(')');
+    if (pos == std::string::npos) {
+        return false;
+    }
+    std::istringstream iss(stat.substr(pos + 1));
+    std::string field;
+    values.clear();
+    for (int index = 3; index <= last && iss >> field; ++index) {
+        if (index >= first) {
+            values.push_back(strtoull(field.c_str(), nullptr, 10));
+        }
+    }
+    return values.size() == (size_t)(last - first + 1);
+}
+
+// 获取进程启动时间（/proc/<pid>/stat第22项，单位clock ticks），进程不存在时返回0
+uint64_t get_process_start_time(pid_t pid)
+{
+    std::vector<uint64_t> values;
+    return get_proc_stat_fields(pid, 22, 22, values) ? values[0] : 0;
+}
+
+uint64_t get_process_cpu_time(pid_t pid)
+{
+    // 第14、15项为用户态和内核态CPU时间，单位clock tick
+    std::vector<uint64_t> values;
+    return get_proc_stat_fields(pid, 14, 15, values) ? values[0] + values[1] : 0;
+}
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+
+#include <libkperf/pmu.h>
+
+#include "logs.h"
+#include "utils.h"
+#include "opt.h"
+#include "validation.h"
+#include "executor.h"
+#include "process_tracker.h"
+
+int PerfCounter::open(pid_t target)
+{
+    close();
+    char *events[] = {(char *)"cycles", (char *)"instructions"};
+    int pids[] = {target};
+    struct PmuAttr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.evtList = events;
+    attr.numEvt = sizeof(events) / sizeof(events[0]);
+    attr.pidList = pids;
+    attr.numPid = 1;
+
+    // 虚拟机等不支持硬件计数的环境下打开失败
+    int fd = PmuOpen(COUNTING, &attr);
+    if (fd < 0) {
+        DEBUG("[run] open counting pmu for pid " << target << " failed: " << Perror());
+        return DFOT_ERROR;
+    }
+    if (PmuEnable(fd) != 0) {
+        DEBUG("[run] enable counting pmu for pid " << target << " failed: " << Perror());
+        PmuClose(fd);
+        return DFOT_ERROR;
+    }
+    pd = fd;
+    pid = target;
+    return DFOT_OK;
+}
+
+void PerfCounter::close()
+{
+    if (pd >= 0) {
+        PmuDisable(pd);
+        PmuClose(pd);
+    }
+    pd = -1;
+    pid = -1;
+}
+
+int PerfCounter::read(uint64_t *cycles, uint64_t *instructions)
+{
+    if (pd < 0) {
+        return DFOT_ERROR;
+    }
+    struct PmuData *data = nullptr;
+    int len = PmuRead(pd, &data);
+    if (len < 0) {
+        return DFOT_ERROR;
+    }
+    // 计数结果按线程和CPU分别给出，累加得到进程总数
+    *cycles = 0;
+    *instructions = 0;
+    for (int i = 0; i < len; ++i) {
+        if (data[i].evt == nullptr) {
+            continue;
+        }
+        if (strcmp(data[i].evt, "cycles") == 0) {
+            *cycles += data[i].count;
+        } else if (strcmp(data[i].evt, "instructions") == 0) {
+            *instructions += data[i].count;
+        }
+    }
+    PmuDataFree(data);
+    return DFOT_OK;
+}
+
+// 追加一条验证结果：<ts> <version> <baseline_cpi> <cpi> <change%> <rolled_back>
+static void record_validation_result(AppConfig *app, const ValidationResult &result)
+{
+    std::string path = configs->tuner_profile_dir + "/" + app->app_name + VALIDATION_FILE_SUFFIX;
+    std::ofstream file(path, std::ios::app);
+    if (!file.is_open()) {
+        WARN("[run] record validation result to " << path << " failed");
+        return;
+    }
+    file << result.candidate.ts << " " << result.version << " " << result.baseline.cpi << " "
+        << result.candidate.cpi << " " << result.change << " " << (result.rolled_back ? 1 : 0) << "\n";
+}
+
+// 回退性能下降的优化版本，之后启动的进程重新使用原始二进制，在优化任务线程中执行
+bool rollback_app_optimization(AppConfig *app)
+{
+    ExecOptions options;
+    options.cancel = optimize_executor.cancel_flag();
+    auto result = exec_cmd({"sysboostd", "--stop=" + app->full_path}, options);
+    if (result.ret != 0) {
+        ERROR("[run] rollback optimization of [" << app->app_name << "] failed!");
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(app->profile_mtx);
+    // 持续优化策略下等待新的profile再次优化，只优化一次策略下不再优化
+    if (configs->tuner_optimizing_strategy == OPTIMIZE_CONTINUOUS && app->status == OPTIMIZED) {
+        app->status = UNOPTIMIZED;
+    }
+    return true;
+}
+
+// 对比优化版本与原始版本的测量窗口，性能下降超过阈值时回退
+static void evaluate_candidate(AppConfig *app, const PerfWindow &window)
+{
+    AppValidation &validation = app->validation;
+    unsigned int rounds = validation.optimized_rounds;
+    if (!validation.has_baseline) {
+        WARN("[run] no baseline of app [" << app->app_name << "], skip validation");
+        validation.validated_rounds = rounds;
+        return;
+    }
+    // 负载差异过大时CPI不可比，等待下一个窗口
+    double high = std::max(window.cpu_usage, validation.baseline.cpu_usage);
+    double low = std::min(window.cpu_usage, validation.baseline.cpu_usage);
+    if (high > low * VALIDATION_LOAD_RATIO) {
+        DEBUG("[run] load of app [" << app->app_name << "] is not comparable: "
+            << validation.baseline.cpu_usage << "% vs " << window.cpu_usage << "%");
+        return;
+    }
+
+    ValidationResult result;
+    {
+        std::lock_guard<std::mutex> lock(app->profile_mtx);
+        result.version = app->instances.size() > 1 ? app->instances.back()->version : rounds;
+    }
+    result.baseline = validation.baseline;
+    result.candidate = window;
+    result.change = (window.cpi / validation.baseline.cpi - 1) * 100;
+    result.rolled_back = false;
+    if (result.change > configs->tuner_validation_threshold) {
+        WARN("[run] version " << result.version << " of app [" << app->app_name << "] regressed by "
+            << result.change << "% (CPI " << result.baseline.cpi << " -> " << result.candidate.cpi
+            << "), rolling back");
+        // 回退命令在任务线程中执行，不阻塞Run()
+        result.rolled_back = optimize_executor.submit_rollback(app);
+        if (!result.rolled_back) {
+            WARN("[run] rollback of app [" << app->app_name << "] is not submitted, a pending job will replace "
+                "the optimized version");
+        }
+    } else {
+        INFO("[run] version " << result.version << " of app [" << app->app_name << "] validated, CPI "
+            << result.baseline.cpi << " -> " << result.candidate.cpi << " (" << result.change << "%)");
+    }
+    validation.validated_rounds = rounds;
+    validation.results.push_back(result);
+    record_validation_result(app, result);
+
+    // 自动调优以CPI变化作为本轮候选选项的得分
+    std::lock_guard<std::mutex> lock(app->profile_mtx);
+    if (app->autotune.enabled && app->autotune.active >= 0) {
+        if (autotune_record(app->autotune, result.change)) {
+            INFO("[run] autotune of app [" << app->app_name << "] converged, pinned options: "
+                << app->autotune.candidates[app->autotune.pinned].options);
+        } else if (app->autotune.exhausted) {
+            WARN("[run] all autotune candidates of app [" << app->app_name << "] regressed beyond "
+                << app->autotune.threshold << "%, stop optimizing");
+        }
+        app->autotune.active = -1;
+    }
+}
+
+// 结束当前测量窗口，丢弃负载过低或数据不足的窗口
+static void finish_window(AppConfig *app, int64_t now)
+{
+    AppValidation &validation = app->validation;
+    pid_t pid = validation.counter.target();
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    int ret = validation.counter.read(&cycles, &instructions);
+    validation.counter.close();
+
+    uint64_t cpu_time = get_process_cpu_time(pid);
+    long ticks = sysconf(_SC_CLK_TCK);
+    if (ret != DFOT_OK || cpu_time < validation.window_cpu_time || ticks <= 0 ||
+        now <= validation.window_start || instructions < VALIDATION_MIN_INSTRUCTIONS) {
+        DEBUG("[run] discard validation window of app [" << app->app_name << "], instructions: " << instructions);
+        return;
+    }
+    PerfWindow window;
+    window.ts = now;
+    window.cycles = cycles;
+    window.instructions = instructions;
+    window.cpi = (double)cycles / instructions;
+    window.cpu_usage = 100.0 * (cpu_time - validation.window_cpu_time) / ticks * 1000 / (now - validation.window_start);
+    if (window.cpu_usage < VALIDATION_MIN_CPU_USAGE) {
+        DEBUG("[run] discard idle validation window of app [" << app->app_name << "]: " << window.cpu_usage << "%");
+        return;
+    }
+
+    if (!validation.candidate) {
+        validation.baseline = window;
+        validation.has_baseline = true;
+        DEBUG("[run] baseline of app [" << app->app_name << "]: CPI " << window.cpi
+            << ", cpu usage " << window.cpu_usage << "%");
+        return;
+    }
+    evaluate_candidate(app, window);
+}
+
+// 原始版本运行时持续刷新基线窗口，有待验证的优化版本运行时测量并与基线对比
+void validate_app_performance(AppConfig *app, int64_t now)
+{
+    AppValidation &validation = app->validation;
+    if (validation.counter.opened()) {
+        if (now - validation.window_start >= configs->tuner_validation_window) {
+            finish_window(app, now);
+        }
+        return;
+    }
+    if (now - validation.last_check < VALIDATION_CHECK_PERIOD) {
+        return;
+    }
+    validation.last_check = now;
+
+    bool candidate = false;
+    pid_t pid = process_tracker.find(app, &candidate);
+    if (pid <= 0) {
+        return;
+    }
+    bool pending = validation.optimized_rounds > validation.validated_rounds;
+    // 已验证过的优化版本无需再测量
+    if (candidate && !pending) {
+        return;
+    }
+    if (validation.counter.open(pid) != DFOT_OK) {
+        // 不支持指令计数时无法验证，直接跳过
+        if (candidate) {
+            WARN("[run] instruction counting is unavailable, skip validation of app [" << app->app_name << "]");
+            validation.validated_rounds = validation.optimized_rounds;
+        }
+        return;
+    }
+    validation.candidate = candidate;
+    validation.window_start = now;
+    validation.window_cpu_time = get_process_cpu_time(pid);
+}
+
+void debug_print_validation(const AppConfig *app)
+{
+    const AppValidation &validation = app->validation;
+    DEBUG("[DFOT_VALIDATION] " << app->app_name << ": optimized " << validation.optimized_rounds
+        << ", validated " << validation.validated_rounds
+        << ", baseline CPI " << (validation.has_baseline ? validation.baseline.cpi : 0)
+        << (validation.counter.opened() ? (validation.candidate ? ", measuring candidate" : ", measuring baseline") : ""));
+    for (size_t i = 0; app->autotune.enabled && i < app->autotune.candidates.size(); ++i) {
+        const AutotuneCandidate &candidate = app->autotune.candidates[i];
+        DEBUG("[DFOT_VALIDATION]   autotune " << i << (app->autotune.pinned == (int)i ? " (pinned)" : "")
+            << ": trials " << candidate.scores.size() << ", score " << autotune_mean_score(candidate)
+            << "%, options: " << candidate.options);
+    }
+    for (const ValidationResult &result : validation.results) {
+        DEBUG("[DFOT_VALIDATION]   version " << result.version << ": CPI " << result.baseline.cpi
+            << " -> " << result.candidate.cpi << " (" << result.change << "%)"
+            << (result.rolled_back ? ", rolled back" : ""));
+    }
+}